@@ -0,0 +1,591 @@
+#ifndef MOTORS_ELMO_DS402_ASYNC_DRIVE_HPP
+#define MOTORS_ELMO_DS402_ASYNC_DRIVE_HPP
+
+/** Coroutine-based API on top of Controller
+ *
+ * This header requires C++20 coroutines. The rest of the library stays
+ * C++11, so it is empty when coroutines are not available.
+ *
+ * Each drive is represented by an AsyncDrive, whose methods return
+ * awaitables that complete when the corresponding SDO transfer does:
+ *
+ * <code>
+ * Task<void> enable(AsyncDrive& drive)
+ * {
+ *     auto temperature = co_await drive.upload<Temperature>();
+ *     co_await drive.send(ControlWord(ControlWord::SHUTDOWN, true));
+ *     co_await drive.transition(ControlWord::ENABLE_OPERATION);
+ * }
+ * </code>
+ *
+ * The coroutines are driven by a single AsyncReactor, which like
+ * SDOScheduler does no I/O by itself: spawn() the flows, then call next()
+ * to get the messages that should be sent and process() with all the
+ * messages received on the bus. next() must be called periodically even if
+ * nothing is received, as it also handles the timeouts and delays. Flows of
+ * different drives run concurrently, and the transfers of a given drive are
+ * done in the order in which they are awaited.
+ *
+ * Failed transfers are reported by throwing SDOAbortError or SDOTimeout
+ * from the co_await expression.
+ */
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <motors_elmo_ds402/Controller.hpp>
+#include <motors_elmo_ds402/SDOTransactionQueue.hpp>
+
+namespace motors_elmo_ds402
+{
+    template<typename T> class Task;
+
+    namespace detail
+    {
+        struct TaskPromiseBase
+        {
+            std::exception_ptr error;
+            std::coroutine_handle<> continuation;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept { return false; }
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<Promise> handle) noexcept
+                {
+                    auto continuation = handle.promise().continuation;
+                    if (continuation)
+                        return continuation;
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        template<typename T>
+        struct TaskPromise : TaskPromiseBase
+        {
+            T value;
+
+            Task<T> get_return_object();
+            void return_value(T v) { value = std::move(v); }
+            T result()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+                return std::move(value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase
+        {
+            Task<void> get_return_object();
+            void return_void() {}
+            void result()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+        };
+    }
+
+    /** A lazily-started coroutine that returns a T
+     *
+     * It starts when it is awaited, or when it is given to
+     * AsyncReactor::spawn
+     */
+    template<typename T>
+    class Task
+    {
+    public:
+        typedef detail::TaskPromise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        explicit Task(Handle handle)
+            : mHandle(handle) {}
+        Task(Task&& other) noexcept
+            : mHandle(std::exchange(other.mHandle, nullptr)) {}
+        Task& operator =(Task&& other) noexcept
+        {
+            std::swap(mHandle, other.mHandle);
+            return *this;
+        }
+        Task(Task const&) = delete;
+        Task& operator =(Task const&) = delete;
+        ~Task()
+        {
+            if (mHandle)
+                mHandle.destroy();
+        }
+
+        /** Whether the coroutine finished, successfully or not */
+        bool isDone() const { return !mHandle || mHandle.done(); }
+
+        /** Starts the coroutine, when it is not awaited by another one */
+        void start() { mHandle.resume(); }
+
+        /** Returns the coroutine's result, or throws its exception
+         *
+         * It must be called only once the task is done
+         */
+        T get() { return mHandle.promise().result(); }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation)
+        {
+            mHandle.promise().continuation = continuation;
+            return mHandle;
+        }
+        T await_resume() { return mHandle.promise().result(); }
+
+    private:
+        Handle mHandle;
+    };
+
+    namespace detail
+    {
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object()
+        {
+            return Task<T>(Task<T>::Handle::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object()
+        {
+            return Task<void>(Task<void>::Handle::from_promise(*this));
+        }
+    }
+
+    class AsyncReactor;
+    class AsyncDrive;
+
+    /** Awaitable that completes when a SDO transfer is done */
+    class SDOOperation
+    {
+    public:
+        SDOOperation(AsyncDrive& drive, canbus::Message const& message)
+            : mDrive(drive)
+            , mMessage(message) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const
+        {
+            if (mFailed)
+                throwFailure();
+        }
+
+    protected:
+        friend class AsyncDrive;
+
+        AsyncDrive& mDrive;
+        canbus::Message mMessage;
+        std::coroutine_handle<> mHandle;
+        bool mFailed = false;
+        SDOTransactionQueue::Failure mFailure;
+
+        void throwFailure() const
+        {
+            if (mFailure.status == SDOTransactionQueue::TRANSACTION_ABORTED)
+                throw SDOAbortError(SDOAbort { mFailure.object, mFailure.abortCode });
+            else
+                throw SDOTimeout(mFailure.object);
+        }
+    };
+
+    /** Awaitable that completes once the reactor's time reaches a deadline
+     *
+     * Created by AsyncReactor::sleep
+     */
+    class DelayOperation
+    {
+    public:
+        DelayOperation(AsyncReactor& reactor, base::Time const& deadline)
+            : mReactor(reactor)
+            , mDeadline(deadline) {}
+
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+    private:
+        AsyncReactor& mReactor;
+        base::Time mDeadline;
+    };
+
+    /** Awaitable that uploads an object and returns its raw value */
+    template<typename T>
+    class UploadOperation : public SDOOperation
+    {
+    public:
+        UploadOperation(AsyncDrive& drive, canbus::Message const& message)
+            : SDOOperation(drive, message) {}
+
+        typename T::OBJECT_TYPE await_resume() const;
+    };
+
+    /** Coroutine interface to a Controller
+     *
+     * Instances are created by AsyncReactor::add
+     */
+    class AsyncDrive
+    {
+    public:
+        AsyncDrive(AsyncReactor& reactor, Controller& controller,
+            SDOTransactionQueue::Policy const& policy)
+            : mReactor(reactor)
+            , mController(controller)
+            , mQueue(controller.getNodeId(), policy) {}
+
+        AsyncDrive(AsyncDrive const&) = delete;
+
+        Controller& getController() { return mController; }
+
+        /** Uploads an object and returns its raw value */
+        template<typename T>
+        UploadOperation<T> upload()
+        {
+            return UploadOperation<T>(*this, mController.queryObject<T>());
+        }
+
+        /** Downloads an object */
+        template<typename T>
+        SDOOperation send(T const& object)
+        {
+            return SDOOperation(*this, mController.send(object));
+        }
+
+        /** Does a SDO transfer given its request message, as returned by
+         * e.g. Controller::setOperationMode
+         *
+         * @throw std::invalid_argument if the message is not a SDO request
+         *   to this drive. Other messages complete as soon as they are sent,
+         *   and would never resume the awaiting coroutine.
+         */
+        SDOOperation request(canbus::Message const& message)
+        {
+            if (!mQueue.isSDORequest(message))
+                throw std::invalid_argument("AsyncDrive::request only accepts SDO requests to the drive");
+            return SDOOperation(*this, message);
+        }
+
+        /** Sends a sequence of SDO requests, one after the other, as
+         * returned by e.g. Controller::configureJointStateUpdatePDOs
+         */
+        Task<void> request(std::vector<canbus::Message> messages)
+        {
+            for (auto const& message : messages)
+                co_await request(message);
+        }
+
+        /** Sends a DS402 transition and waits for the drive to reach the
+         * corresponding state
+         *
+         * The status word is polled through SDO, at most once every
+         * \c pollPeriod
+         *
+         * @throw std::runtime_error if the drive goes in fault, or does not
+         *   reach the expected state within \c timeout
+         */
+        Task<void> transition(ControlWord::Transition transition,
+            bool enableHalt = false,
+            base::Time timeout = base::Time::fromMilliseconds(1000),
+            base::Time pollPeriod = base::Time::fromMilliseconds(5));
+
+        /** The state a transition leads to */
+        static StatusWord::State getTransitionTarget(ControlWord::Transition transition)
+        {
+            switch(transition)
+            {
+                case ControlWord::SHUTDOWN: return StatusWord::READY_TO_SWITCH_ON;
+                case ControlWord::SWITCH_ON: return StatusWord::SWITCH_ON;
+                case ControlWord::ENABLE_OPERATION: return StatusWord::OPERATION_ENABLED;
+                case ControlWord::QUICK_STOP: return StatusWord::QUICK_STOP_ACTIVE;
+                case ControlWord::DISABLE_OPERATION: return StatusWord::SWITCH_ON;
+                default: return StatusWord::SWITCH_ON_DISABLED;
+            }
+        }
+
+    private:
+        friend class SDOOperation;
+        friend class AsyncReactor;
+
+        AsyncReactor& mReactor;
+        Controller& mController;
+        SDOTransactionQueue mQueue;
+        /** The operations that wait for the transfers in mQueue, in order */
+        std::deque<SDOOperation*> mOperations;
+
+        void enqueue(SDOOperation& operation)
+        {
+            mQueue.push(operation.mMessage);
+            mOperations.push_back(&operation);
+        }
+
+        /** Resolves the oldest pending operation
+         *
+         * @return the handle of the coroutine that must be resumed
+         */
+        std::coroutine_handle<> complete(SDOTransactionQueue::Failure const* failure)
+        {
+            SDOOperation* operation = mOperations.front();
+            mOperations.pop_front();
+            if (failure)
+            {
+                operation->mFailed = true;
+                operation->mFailure = *failure;
+            }
+            return operation->mHandle;
+        }
+    };
+
+    /** Drives the coroutines of several AsyncDrive on a single bus */
+    class AsyncReactor
+    {
+    public:
+        /** Creates the reactor
+         *
+         * The transfers of concurrent flows are independent, so the
+         * remaining transfers are never dropped after a failure:
+         * stopOnFailure is ignored. Each failure is reported to the
+         * coroutine that awaits the failed transfer instead.
+         */
+        explicit AsyncReactor(
+            SDOTransactionQueue::Policy const& policy = SDOTransactionQueue::Policy())
+            : mPolicy(policy)
+        {
+            // Dropping the queued transfers would leave the coroutines that
+            // await them suspended forever
+            mPolicy.stopOnFailure = false;
+        }
+
+        /** Registers a controller
+         *
+         * The controller must remain valid for the lifetime of the reactor,
+         * and there must be only one controller per node
+         */
+        AsyncDrive& add(Controller& controller)
+        {
+            mDrives.emplace_back(new AsyncDrive(*this, controller, mPolicy));
+            return *mDrives.back();
+        }
+
+        /** Starts a flow
+         *
+         * The reactor takes ownership of the task
+         */
+        void spawn(Task<void> task)
+        {
+            mTasks.push_back(std::move(task));
+            mTasks.back().start();
+        }
+
+        /** Returns an awaitable that completes after \c duration
+         *
+         * The time is the one given to next(), so the actual delay depends
+         * on how often it is called
+         */
+        DelayOperation sleep(base::Time const& duration)
+        {
+            return DelayOperation(*this, mNow + duration);
+        }
+
+        /** Appends the messages that should be sent now to \c messages
+         *
+         * It first resumes the coroutines whose delay expired, then detects
+         * the transfers that timed out, and resumes the corresponding
+         * coroutines
+         *
+         * @return the number of messages that have been added
+         */
+        size_t next(base::Time const& now, std::vector<canbus::Message>& messages)
+        {
+            mNow = now;
+            resumeExpiredTimers();
+
+            size_t count = 0;
+            std::vector<std::coroutine_handle<>> ready;
+            for (auto& drive : mDrives)
+            {
+                canbus::Message message;
+                while (true)
+                {
+                    size_t failures = drive->mQueue.getFailures().size();
+                    bool sent = drive->mQueue.next(now, message);
+                    // A timeout is reported by next(), which then moves on
+                    // to the next transfer
+                    auto const& allFailures = drive->mQueue.getFailures();
+                    for (size_t i = failures; i < allFailures.size(); ++i)
+                        ready.push_back(drive->complete(&allFailures[i]));
+                    if (!sent)
+                        break;
+
+                    messages.push_back(message);
+                    ++count;
+                }
+            }
+            resume(ready);
+            return count;
+        }
+
+        /** Process a message received on the bus
+         *
+         * @return the update returned by Controller::process
+         */
+        Update process(canbus::Message const& message)
+        {
+            // All the COB-IDs of the predefined connection set end with the
+            // node ID
+            AsyncDrive* drive = findDrive(message.can_id & 0x7F);
+            if (!drive)
+                return Update();
+
+            Update update = drive->mController.process(message);
+            size_t failures = drive->mQueue.getFailures().size();
+            if (drive->mQueue.process(update))
+            {
+                auto const& allFailures = drive->mQueue.getFailures();
+                std::coroutine_handle<> handle = drive->complete(
+                    allFailures.size() > failures ? &allFailures.back() : nullptr);
+                handle.resume();
+            }
+            return update;
+        }
+
+        /** Whether all spawned flows are finished */
+        bool isDone() const
+        {
+            for (auto const& task : mTasks)
+            {
+                if (!task.isDone())
+                    return false;
+            }
+            return true;
+        }
+
+        /** Rethrows the exception of the first finished flow that failed */
+        void checkErrors()
+        {
+            for (auto& task : mTasks)
+            {
+                if (task.isDone())
+                    task.get();
+            }
+        }
+
+        /** The time given to the last call to next() */
+        base::Time now() const { return mNow; }
+
+    private:
+        friend class DelayOperation;
+
+        SDOTransactionQueue::Policy mPolicy;
+        std::vector<std::unique_ptr<AsyncDrive>> mDrives;
+        std::vector<Task<void>> mTasks;
+        base::Time mNow = base::Time::now();
+
+        struct Timer
+        {
+            base::Time deadline;
+            std::coroutine_handle<> handle;
+        };
+        std::vector<Timer> mTimers;
+
+        void resumeExpiredTimers()
+        {
+            std::vector<std::coroutine_handle<>> ready;
+            for (auto it = mTimers.begin(); it != mTimers.end(); )
+            {
+                if (it->deadline <= mNow)
+                {
+                    ready.push_back(it->handle);
+                    it = mTimers.erase(it);
+                }
+                else
+                    ++it;
+            }
+            resume(ready);
+        }
+
+        AsyncDrive* findDrive(uint8_t nodeId)
+        {
+            for (auto& drive : mDrives)
+            {
+                if (drive->mController.getNodeId() == nodeId)
+                    return drive.get();
+            }
+            return nullptr;
+        }
+
+        void resume(std::vector<std::coroutine_handle<>> const& handles)
+        {
+            for (auto handle : handles)
+                handle.resume();
+        }
+    };
+
+    inline bool DelayOperation::await_ready() const noexcept
+    {
+        return mDeadline <= mReactor.now();
+    }
+
+    inline void DelayOperation::await_suspend(std::coroutine_handle<> handle)
+    {
+        mReactor.mTimers.push_back(AsyncReactor::Timer { mDeadline, handle });
+    }
+
+    inline void SDOOperation::await_suspend(std::coroutine_handle<> handle)
+    {
+        mHandle = handle;
+        mDrive.enqueue(*this);
+    }
+
+    template<typename T>
+    typename T::OBJECT_TYPE UploadOperation<T>::await_resume() const
+    {
+        if (mFailed)
+            throwFailure();
+        return mDrive.getController().template getRaw<T>();
+    }
+
+    inline Task<void> AsyncDrive::transition(ControlWord::Transition transition,
+        bool enableHalt, base::Time timeout, base::Time pollPeriod)
+    {
+        co_await send(ControlWord(transition, enableHalt));
+
+        StatusWord::State target = getTransitionTarget(transition);
+        base::Time deadline = mReactor.now() + timeout;
+        while (true)
+        {
+            co_await request(mController.queryStatusWord());
+            StatusWord::State state = mController.tryGetStatusWord().state;
+            if (state == target)
+                co_return;
+            else if (state == StatusWord::FAULT)
+                throw std::runtime_error("drive went in fault during transition");
+            else if (mReactor.now() > deadline)
+                throw std::runtime_error("drive did not reach the expected state in time");
+
+            // The drive answers within a few hundred microseconds, polling
+            // again right away would flood the bus
+            co_await mReactor.sleep(pollPeriod);
+        }
+    }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#include <motors_elmo_ds402/BringUp.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BringUp::BringUp(SDOTransactionQueue::Policy const& policy, Timing const& timing)
+    : mTiming(timing)
+    , mScheduler(policy)
+{
+}
+
+int BringUp::add(Controller& controller,
+    vector<canbus::Message> const& configuration, OPERATION_MODES mode)
+{
+    int index = mScheduler.add(controller);
+    mScheduler.push(index, controller.queryNodeStateTransition(
+        canopen_master::NODE_ENTER_PRE_OPERATIONAL));
+    mScheduler.push(index, configuration);
+    mScheduler.push(index, controller.queryNodeStateTransition(
+        canopen_master::NODE_START));
+    mScheduler.push(index, controller.setOperationMode(mode));
+    mNodes.push_back(Node { STEP_CONFIGURE, base::Time(), base::Time() });
+    return index;
+}
+
+size_t BringUp::next(base::Time const& now, vector<canbus::Message>& messages)
+{
+    for (size_t i = 0; i < mNodes.size(); ++i)
+        advance(i, now);
+    return mScheduler.next(now, messages);
+}
+
+void BringUp::startTransition(int index, ControlWord const& controlWord,
+    STEPS step, base::Time const& now)
+{
+    Controller& controller = mScheduler.getController(index);
+    mScheduler.push(index, controller.send(controlWord));
+    mScheduler.push(index, controller.queryStatusWord());
+
+    Node& node = mNodes[index];
+    node.step = step;
+    node.deadline = now + mTiming.stateTimeout;
+    node.nextPoll = now + mTiming.statusPollPeriod;
+}
+
+void BringUp::advance(int index, base::Time const& now)
+{
+    Node& node = mNodes[index];
+    if (node.step == STEP_DONE || node.step == STEP_FAILED)
+        return;
+
+    SDOTransactionQueue const& queue = mScheduler.getQueue(index);
+    if (queue.hasFailed())
+    {
+        node.step = STEP_FAILED;
+        return;
+    }
+    else if (!queue.isDone())
+        return;
+
+    if (node.step == STEP_CONFIGURE)
+    {
+        startTransition(index, ControlWord(ControlWord::SHUTDOWN, true),
+            STEP_SHUTDOWN, now);
+        return;
+    }
+
+    // The queue is done, so the status word is at least as recent as the
+    // ack of the last control word
+    StatusWord::State expected;
+    switch(node.step)
+    {
+        case STEP_SHUTDOWN: expected = StatusWord::READY_TO_SWITCH_ON; break;
+        case STEP_SWITCH_ON: expected = StatusWord::SWITCH_ON; break;
+        default: expected = StatusWord::OPERATION_ENABLED; break;
+    }
+
+    StatusWord::State state =
+        mScheduler.getController(index).tryGetStatusWord().state;
+    if (state == expected)
+    {
+        switch(node.step)
+        {
+            case STEP_SHUTDOWN:
+                startTransition(index, ControlWord(ControlWord::SWITCH_ON, true),
+                    STEP_SWITCH_ON, now);
+                break;
+            case STEP_SWITCH_ON:
+                startTransition(index, ControlWord(ControlWord::ENABLE_OPERATION, false),
+                    STEP_ENABLE_OPERATION, now);
+                break;
+            default:
+                node.step = STEP_DONE;
+        }
+    }
+    else if (state == StatusWord::FAULT || now > node.deadline)
+        node.step = STEP_FAILED;
+    else if (now >= node.nextPoll)
+    {
+        mScheduler.push(index, mScheduler.getController(index).queryStatusWord());
+        node.nextPoll = now + mTiming.statusPollPeriod;
+    }
+}
+
+Update BringUp::process(canbus::Message const& message)
+{
+    return mScheduler.process(message);
+}
+
+bool BringUp::isDone() const
+{
+    for (Node const& node : mNodes)
+    {
+        if (node.step != STEP_DONE && node.step != STEP_FAILED)
+            return false;
+    }
+    return true;
+}
+
+bool BringUp::hasFailed() const
+{
+    for (Node const& node : mNodes)
+    {
+        if (node.step == STEP_FAILED)
+            return true;
+    }
+    return false;
+}
+
+size_t BringUp::size() const
+{
+    return mNodes.size();
+}
+
+BringUp::STEPS BringUp::getStep(int index) const
+{
+    return mNodes.at(index).step;
+}
+
+SDOTransactionQueue const& BringUp::getQueue(int index) const
+{
+    return mScheduler.getQueue(index);
+}
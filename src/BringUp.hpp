@@ -0,0 +1,121 @@
+#ifndef MOTORS_ELMO_DS402_BRING_UP_HPP
+#define MOTORS_ELMO_DS402_BRING_UP_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Timing parameters of the state transitions in BringUp */
+    struct BringUpTiming
+    {
+        /** How long to wait for the drive to reach the expected state after
+         * a transition
+         */
+        base::Time stateTimeout = base::Time::fromMilliseconds(1000);
+        /** Period at which the status word is polled while waiting */
+        base::Time statusPollPeriod = base::Time::fromMilliseconds(5);
+    };
+
+    /** Runs the DS402 enable sequence on several drives in parallel
+     *
+     * For each drive, it:
+     * - puts the node in pre-operational state
+     * - sends the configuration (e.g. the PDO configuration)
+     * - starts the node and sets the operation mode
+     * - goes through the SHUTDOWN, SWITCH_ON and ENABLE_OPERATION transitions,
+     *   waiting for the drive's status word to report the expected state
+     *   before doing the next one
+     *
+     * Each drive advances as soon as its acks and status words arrive,
+     * independently of the other drives. The status word is polled through
+     * SDO if it is not received through a PDO.
+     *
+     * Like SDOScheduler, it does no I/O by itself. Call next() to get the
+     * messages that should be sent, and process() with all the messages
+     * received on the bus, until isDone() returns true.
+     */
+    class BringUp
+    {
+    public:
+        enum STEPS
+        {
+            /** Sending the configuration and the operation mode */
+            STEP_CONFIGURE,
+            /** Waiting for READY_TO_SWITCH_ON after a SHUTDOWN */
+            STEP_SHUTDOWN,
+            /** Waiting for SWITCH_ON after a SWITCH_ON */
+            STEP_SWITCH_ON,
+            /** Waiting for OPERATION_ENABLED after a ENABLE_OPERATION */
+            STEP_ENABLE_OPERATION,
+            /** The drive is enabled */
+            STEP_DONE,
+            /** The bring-up failed, see getQueue() for SDO failures */
+            STEP_FAILED
+        };
+
+        typedef BringUpTiming Timing;
+
+        explicit BringUp(
+            SDOTransactionQueue::Policy const& policy = SDOTransactionQueue::Policy(),
+            Timing const& timing = Timing());
+
+        /** Register a drive to bring up
+         *
+         * The controller must remain valid for the lifetime of this object
+         *
+         * @param configuration the messages to send while the node is in
+         *   pre-operational state, e.g. the PDO configuration
+         * @param mode the operation mode to set before enabling the drive
+         * @return the drive's index
+         */
+        int add(Controller& controller,
+            std::vector<canbus::Message> const& configuration,
+            OPERATION_MODES mode);
+
+        /** Appends the messages that should be sent now to \c messages
+         *
+         * @return the number of messages that have been added
+         */
+        size_t next(base::Time const& now, std::vector<canbus::Message>& messages);
+
+        /** Process a message received on the bus
+         *
+         * @see SDOScheduler::process
+         */
+        Update process(canbus::Message const& message);
+
+        /** Whether all drives are either enabled or failed */
+        bool isDone() const;
+
+        /** Whether the bring-up of at least one drive failed */
+        bool hasFailed() const;
+
+        /** Number of registered drives */
+        size_t size() const;
+
+        /** The current step of the given drive */
+        STEPS getStep(int index) const;
+
+        /** The SDO queue of the given drive */
+        SDOTransactionQueue const& getQueue(int index) const;
+
+    private:
+        struct Node
+        {
+            STEPS step;
+            base::Time deadline;
+            base::Time nextPoll;
+        };
+
+        Timing mTiming;
+        SDOScheduler mScheduler;
+        std::vector<Node> mNodes;
+
+        void advance(int index, base::Time const& now);
+        void startTransition(int index, ControlWord const& controlWord,
+            STEPS step, base::Time const& now);
+    };
+}
+
+#endif
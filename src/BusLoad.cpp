@@ -0,0 +1,271 @@
+#include <motors_elmo_ds402/BusLoad.hpp>
+#include "CANopenProtocol.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+int motors_elmo_ds402::getWorstCaseFrameBits(int dataSize)
+{
+    // 47 bits of framing and interframe space, plus one stuff bit every 4
+    // bits in the worst case for the 34 + 8n bits that are subject to
+    // stuffing
+    return 8 * dataSize + 47 + (34 + 8 * dataSize - 1) / 4;
+}
+
+BusLoad::BusLoad(int bitrate, base::Time const& syncPeriod)
+    : mBitrate(bitrate)
+{
+    if (bitrate <= 0)
+        throw std::invalid_argument("the bitrate must be positive");
+    setSyncPeriod(syncPeriod);
+}
+
+int BusLoad::getBitrate() const
+{
+    return mBitrate;
+}
+
+base::Time BusLoad::getSyncPeriod() const
+{
+    return mSyncPeriod;
+}
+
+void BusLoad::setSyncPeriod(base::Time const& period)
+{
+    if (period.toMicroseconds() <= 0)
+        throw std::invalid_argument("the SYNC period must be positive");
+    mSyncPeriod = period;
+}
+
+void BusLoad::addFrame(BusFrame const& frame)
+{
+    if (frame.size < 0 || frame.size > 8)
+        throw std::invalid_argument("frame size must be between 0 and 8");
+    if (frame.syncDivisor < 0 ||
+        (frame.syncDivisor == 0 && frame.period.toMicroseconds() <= 0))
+        throw std::invalid_argument("frame must have either a SYNC divisor or a positive period");
+    mFrames.push_back(frame);
+}
+
+void BusLoad::addConfiguration(vector<canbus::Message> const& messages)
+{
+    for (auto const& msg : messages)
+    {
+        if ((msg.can_id & ~0x7F) != SDO_CLIENT_COB_ID || msg.size != 8)
+            continue;
+
+        uint32_t fullId;
+        uint32_t value;
+        uint8_t size;
+        if ((msg.data[0] & SDO_COMMAND_MASK) != SDO_INITIATE_DOWNLOAD_REQUEST ||
+            !decodeExpedited(msg, fullId, value, size))
+            continue;
+
+        int objectId = fullId >> 8;
+        int subId = fullId & 0xFF;
+        if (!isPDOParameters(objectId))
+            continue;
+
+        int node = msg.can_id - SDO_CLIENT_COB_ID;
+        bool transmit = (objectId >= TPDO_PARAMETERS);
+        int parametersId = objectId & ~PDO_MAPPING_OFFSET;
+        bool isMapping = (objectId & PDO_MAPPING_OFFSET);
+
+        auto key = make_pair(node, parametersId);
+        auto it = mPDOs.find(key);
+        if (it == mPDOs.end())
+        {
+            PDOState state;
+            state.transmit = transmit;
+            // Default COB-IDs of the first four PDOs
+            int pdoIndex = parametersId - (transmit ? TPDO_PARAMETERS : RPDO_PARAMETERS);
+            state.cobId = (transmit ? TPDO_COB_ID : RPDO_COB_ID) + 0x100 * pdoIndex + node;
+            it = mPDOs.insert(make_pair(key, state)).first;
+        }
+        PDOState& state = it->second;
+
+        if (isMapping)
+        {
+            if (subId == 0)
+                state.mappingCount = value;
+            else
+                state.mappingBits[subId] = value & 0xFF;
+        }
+        else if (subId == PDO_COB_ID_SUB_ID)
+        {
+            state.cobId = value & 0x7FF;
+            state.enabled = !(value & PDO_COB_ID_INVALID);
+        }
+        else if (subId == PDO_TRANSMISSION_TYPE_SUB_ID)
+            state.transmissionType = value;
+        else if (subId == PDO_INHIBIT_TIME_SUB_ID)
+            state.inhibitTime = value;
+        else if (subId == PDO_EVENT_TIMER_SUB_ID)
+            state.eventTimer = value;
+    }
+}
+
+bool BusLoad::PDOState::getFrame(BusFrame& frame) const
+{
+    if (!enabled)
+        return false;
+
+    int bits = 0;
+    for (auto const& entry : mappingBits)
+    {
+        if (mappingCount < 0 || entry.first <= mappingCount)
+            bits += entry.second;
+    }
+    if (bits == 0)
+        return false;
+
+    frame.cobId = cobId;
+    frame.size = (bits + 7) / 8;
+    frame.syncDivisor = 1;
+    if (!transmit)
+        return true;
+
+    if (transmissionType == TRANSMISSION_RTR_SYNC ||
+        transmissionType == TRANSMISSION_RTR_EVENT)
+        return false;
+    else if (transmissionType == 0)
+        return true;
+    else if (transmissionType <= TRANSMISSION_SYNC_MAX)
+    {
+        frame.syncDivisor = transmissionType;
+        return true;
+    }
+    else if (inhibitTime > 0)
+    {
+        frame.syncDivisor = 0;
+        frame.period = base::Time::fromMicroseconds(100 * inhibitTime);
+    }
+    else if (eventTimer > 0)
+    {
+        frame.syncDivisor = 0;
+        frame.period = base::Time::fromMilliseconds(eventTimer);
+    }
+    return true;
+}
+
+vector<BusFrame> BusLoad::getFrames() const
+{
+    vector<BusFrame> frames;
+    BusFrame sync;
+    sync.cobId = SYNC_COB_ID;
+    frames.push_back(sync);
+    frames.insert(frames.end(), mFrames.begin(), mFrames.end());
+
+    for (auto const& pdo : mPDOs)
+    {
+        BusFrame frame;
+        if (pdo.second.getFrame(frame))
+            frames.push_back(frame);
+    }
+    return frames;
+}
+
+double BusLoad::getAverageLoad() const
+{
+    double syncPeriod = mSyncPeriod.toSeconds();
+    double bitsPerSecond = 0;
+    for (auto const& frame : getFrames())
+    {
+        double period = frame.syncDivisor ?
+            syncPeriod * frame.syncDivisor : frame.period.toSeconds();
+        bitsPerSecond += getWorstCaseFrameBits(frame.size) / period;
+    }
+    return bitsPerSecond / mBitrate;
+}
+
+/** Number of occurences of a frame in the busiest SYNC period of the given
+ * length
+ */
+static int64_t getCountPerCycle(BusFrame const& frame, int64_t syncPeriodUsec)
+{
+    if (frame.syncDivisor)
+        return 1;
+    int64_t period = frame.period.toMicroseconds();
+    return (syncPeriodUsec + period - 1) / period;
+}
+
+int64_t BusLoad::computeBitsPerCycle(vector<BusFrame> const& frames,
+    base::Time const& syncPeriod)
+{
+    int64_t bits = 0;
+    for (auto const& frame : frames)
+        bits += getCountPerCycle(frame, syncPeriod.toMicroseconds()) *
+            getWorstCaseFrameBits(frame.size);
+    return bits;
+}
+
+int BusLoad::getFramesPerCycle() const
+{
+    int64_t count = 0;
+    for (auto const& frame : getFrames())
+        count += getCountPerCycle(frame, mSyncPeriod.toMicroseconds());
+    return count;
+}
+
+int64_t BusLoad::getBitsPerCycle() const
+{
+    return computeBitsPerCycle(getFrames(), mSyncPeriod);
+}
+
+double BusLoad::getCycleLoad() const
+{
+    return getBitsPerCycle() / (mSyncPeriod.toSeconds() * mBitrate);
+}
+
+void BusLoad::validate(double budget) const
+{
+    double load = getCycleLoad();
+    if (load > budget)
+    {
+        ostringstream message;
+        message << "bus load of " << load * 100 << "% (" << getFramesPerCycle()
+            << " frames per cycle) exceeds the budget of " << budget * 100
+            << "%, the SYNC period must be at least "
+            << getMinimumSyncPeriod(budget).toMicroseconds() << "us";
+        throw std::runtime_error(message.str());
+    }
+}
+
+base::Time BusLoad::getMinimumSyncPeriod(double budget) const
+{
+    vector<BusFrame> frames = getFrames();
+
+    // Bits per microsecond available, and used by the frames that do not
+    // depend on the SYNC
+    double capacity = budget * mBitrate / 1e6;
+    double asyncRate = 0;
+    int64_t syncBits = 0;
+    for (auto const& frame : frames)
+    {
+        int bits = getWorstCaseFrameBits(frame.size);
+        if (frame.syncDivisor)
+            syncBits += bits;
+        else
+            asyncRate += static_cast<double>(bits) / frame.period.toMicroseconds();
+    }
+    if (asyncRate >= capacity)
+        throw std::runtime_error("the frames that are not triggered by the SYNC exceed the bus budget");
+
+    // The number of bits in a cycle only increases with the period, so
+    // iterating from a lower bound converges to the smallest period that
+    // fits
+    double lowerBound = syncBits / (capacity - asyncRate);
+    base::Time period = base::Time::fromMicroseconds(max<int64_t>(1, lowerBound));
+    while (true)
+    {
+        int64_t bits = computeBitsPerCycle(frames, period);
+        int64_t needed = static_cast<int64_t>(ceil(bits / capacity));
+        if (needed <= period.toMicroseconds())
+            return period;
+        period = base::Time::fromMicroseconds(needed);
+    }
+}
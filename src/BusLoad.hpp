@@ -0,0 +1,154 @@
+#ifndef MOTORS_ELMO_DS402_BUS_LOAD_HPP
+#define MOTORS_ELMO_DS402_BUS_LOAD_HPP
+
+#include <map>
+#include <vector>
+#include <base/Time.hpp>
+#include <canbus/Message.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Worst-case length in bits of a standard (11-bit identifier) CAN frame
+     *
+     * It includes the bit stuffing, the end of frame and the interframe space
+     */
+    int getWorstCaseFrameBits(int dataSize);
+
+    /** A periodic frame on the bus, as seen by BusLoad */
+    struct BusFrame
+    {
+        uint32_t cobId = 0;
+        /** The size of the frame's payload in bytes */
+        int size = 0;
+        /** Number of SYNC periods between two frames, or zero if the frame
+         * is not triggered by the SYNC. In this case, period is used
+         */
+        int syncDivisor = 1;
+        /** Minimum time between two frames that are not triggered by the
+         * SYNC
+         */
+        base::Time period;
+    };
+
+    /** Estimates the worst-case load of the bus caused by a set of periodic
+     * frames, mainly the PDOs
+     *
+     * The PDOs are usually added with addConfiguration(), which decodes the
+     * configuration messages returned by e.g.
+     * Controller::configureJointStateUpdatePDOs or
+     * Controller::configureControlPDO. The estimation assumes that:
+     * - synchronous TPDOs are sent at their SYNC rate, and acyclic
+     *   synchronous TPDOs at every SYNC
+     * - event-driven TPDOs are sent at their inhibit time, or at their event
+     *   timer period if they have no inhibit time, or once per SYNC if they
+     *   have neither
+     * - RPDOs are sent once per SYNC period by the host
+     *
+     * SDO traffic is not included. Keep some of the budget for it.
+     */
+    class BusLoad
+    {
+    public:
+        /**
+         * @param bitrate the bus bitrate in bits per second
+         * @param syncPeriod the SYNC period. The SYNC frame itself is part
+         *   of the load.
+         * @throw std::invalid_argument if either is not positive
+         */
+        BusLoad(int bitrate, base::Time const& syncPeriod);
+
+        int getBitrate() const;
+
+        base::Time getSyncPeriod() const;
+
+        /** Change the SYNC period, e.g. to the one returned by
+         * getMinimumSyncPeriod
+         */
+        void setSyncPeriod(base::Time const& period);
+
+        /** Add a frame that is not described by a PDO configuration */
+        void addFrame(BusFrame const& frame);
+
+        /** Decode the PDO configuration of a set of SDO downloads
+         *
+         * The messages are the ones returned by the PDO configuration
+         * methods of Controller, for any number of nodes. Later messages
+         * override earlier ones, so that a PDO that is reconfigured or
+         * disabled is accounted for only once.
+         */
+        void addConfiguration(std::vector<canbus::Message> const& messages);
+
+        /** Returns all the frames that are taken into account, including
+         * the SYNC
+         */
+        std::vector<BusFrame> getFrames() const;
+
+        /** Average load of the bus, between 0 and 1 */
+        double getAverageLoad() const;
+
+        /** Number of frames in the busiest SYNC period
+         *
+         * This is when all synchronous frames are due at the same time
+         */
+        int getFramesPerCycle() const;
+
+        /** Number of bits in the busiest SYNC period */
+        int64_t getBitsPerCycle() const;
+
+        /** Load of the bus in the busiest SYNC period, between 0 and 1
+         *
+         * If greater than 1, frames will be late
+         */
+        double getCycleLoad() const;
+
+        /** Checks that the load of the busiest cycle is within budget
+         *
+         * @param budget the acceptable load, between 0 and 1
+         * @throw std::runtime_error if the configuration exceeds the budget
+         */
+        void validate(double budget) const;
+
+        /** Returns the shortest SYNC period, with a microsecond resolution,
+         * for which the load of the busiest cycle is within budget
+         *
+         * @throw std::runtime_error if the frames that are not triggered
+         *   by the SYNC exceed the budget by themselves
+         */
+        base::Time getMinimumSyncPeriod(double budget) const;
+
+    private:
+        /** Communication and mapping parameters of a PDO, as decoded by
+         * addConfiguration
+         */
+        struct PDOState
+        {
+            bool transmit = false;
+            uint32_t cobId = 0;
+            bool enabled = true;
+            int transmissionType = 0xFF;
+            /** Inhibit time in multiples of 100us */
+            int inhibitTime = 0;
+            /** Event timer in milliseconds */
+            int eventTimer = 0;
+            /** Number of mapped objects, or -1 if not set */
+            int mappingCount = -1;
+            /** Size in bits of the mapped objects, indexed by mapping sub */
+            std::map<int, int> mappingBits;
+
+            bool getFrame(BusFrame& frame) const;
+        };
+
+        int mBitrate;
+        base::Time mSyncPeriod;
+        std::vector<BusFrame> mFrames;
+        /** PDOs decoded by addConfiguration, indexed by node and the index
+         * of their communication parameters object
+         */
+        std::map<std::pair<int, int>, PDOState> mPDOs;
+
+        static int64_t computeBitsPerCycle(std::vector<BusFrame> const& frames,
+            base::Time const& syncPeriod);
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef MOTORS_ELMO_DS402_CANOPEN_PROTOCOL_HPP
+#define MOTORS_ELMO_DS402_CANOPEN_PROTOCOL_HPP
+
+#include <cstdint>
+#include <canbus/Message.hpp>
+
+/** @file
+ * CiA 301 constants and frame decoding helpers shared by the library's
+ * implementation files. This header is not installed.
+ */
+
+namespace motors_elmo_ds402
+{
+    /** COB-ID of the SYNC message */
+    static const uint32_t SYNC_COB_ID = 0x80;
+    /** Base COB-ID of the SDO requests, to be added to the node ID */
+    static const uint32_t SDO_CLIENT_COB_ID = 0x600;
+    /** Base COB-ID of the SDO responses, to be added to the node ID */
+    static const uint32_t SDO_SERVER_COB_ID = 0x580;
+    /** Base COB-ID of the first TPDO, to be added to the node ID and to
+     * 0x100 times the PDO index
+     */
+    static const uint32_t TPDO_COB_ID = 0x180;
+    /** Base COB-ID of the first RPDO, to be added to the node ID and to
+     * 0x100 times the PDO index
+     */
+    static const uint32_t RPDO_COB_ID = 0x200;
+
+    /** Communication parameters of the first RPDO */
+    static const uint16_t RPDO_PARAMETERS = 0x1400;
+    /** Communication parameters of the first TPDO */
+    static const uint16_t TPDO_PARAMETERS = 0x1800;
+    /** Offset from the communication to the mapping parameters of a PDO */
+    static const uint16_t PDO_MAPPING_OFFSET = 0x200;
+    /** End of the range of the PDO communication and mapping parameters */
+    static const uint16_t PDO_PARAMETERS_END = 0x1C00;
+    /** Sub-indexes of the PDO communication parameters */
+    static const uint8_t PDO_COB_ID_SUB_ID = 1;
+    static const uint8_t PDO_TRANSMISSION_TYPE_SUB_ID = 2;
+    static const uint8_t PDO_INHIBIT_TIME_SUB_ID = 3;
+    static const uint8_t PDO_EVENT_TIMER_SUB_ID = 5;
+    /** Bit of the PDO COB-ID parameter that disables the PDO */
+    static const uint32_t PDO_COB_ID_INVALID = 0x80000000;
+    /** Highest transmission type that is a SYNC divisor */
+    static const int TRANSMISSION_SYNC_MAX = 240;
+    static const int TRANSMISSION_RTR_SYNC = 0xFC;
+    static const int TRANSMISSION_RTR_EVENT = 0xFD;
+
+    /** Mask of the command specifier in the first byte of an SDO frame */
+    static const uint8_t SDO_COMMAND_MASK = 0xE0;
+    static const uint8_t SDO_ABORT_COMMAND = 0x80;
+    static const uint8_t SDO_INITIATE_DOWNLOAD_REQUEST = 0x20;
+    static const uint8_t SDO_INITIATE_DOWNLOAD_RESPONSE = 0x60;
+    static const uint8_t SDO_DOWNLOAD_SEGMENT_RESPONSE = 0x20;
+    static const uint8_t SDO_INITIATE_UPLOAD_REQUEST = 0x40;
+    static const uint8_t SDO_INITIATE_UPLOAD_RESPONSE = 0x40;
+    static const uint8_t SDO_UPLOAD_SEGMENT_REQUEST = 0x60;
+    static const uint8_t SDO_UPLOAD_SEGMENT_RESPONSE = 0x00;
+    static const uint8_t SDO_BLOCK_UPLOAD_INITIATE_REQUEST = 0xA0;
+    static const uint8_t SDO_BLOCK_UPLOAD_START_REQUEST = 0xA3;
+    static const uint8_t SDO_BLOCK_UPLOAD_ACK_REQUEST = 0xA2;
+    static const uint8_t SDO_BLOCK_UPLOAD_END_REQUEST = 0xA1;
+    /** Flag of the initiate frames whose data is in the frame itself */
+    static const uint8_t SDO_EXPEDITED = 0x02;
+
+    inline uint32_t decodeUInt32(uint8_t const* data)
+    {
+        return static_cast<uint32_t>(data[0]) |
+            static_cast<uint32_t>(data[1]) << 8 |
+            static_cast<uint32_t>(data[2]) << 16 |
+            static_cast<uint32_t>(data[3]) << 24;
+    }
+
+    inline uint16_t decodeUInt16(uint8_t const* data)
+    {
+        return static_cast<uint16_t>(data[0] | data[1] << 8);
+    }
+
+    /** Whether an object is a PDO communication or mapping parameter */
+    inline bool isPDOParameters(uint16_t objectId)
+    {
+        return objectId >= RPDO_PARAMETERS && objectId < PDO_PARAMETERS_END;
+    }
+
+    /** The object of an SDO frame, as (object ID << 8 | sub ID) */
+    inline uint32_t sdoFullId(canbus::Message const& msg)
+    {
+        return static_cast<uint32_t>(msg.data[1] | msg.data[2] << 8) << 8 | msg.data[3];
+    }
+
+    /** Decodes the object and value of an expedited SDO transfer
+     *
+     * @return false if the message is not an expedited transfer
+     */
+    inline bool decodeExpedited(canbus::Message const& msg,
+        uint32_t& fullId, uint32_t& value, uint8_t& size)
+    {
+        if (!(msg.data[0] & SDO_EXPEDITED))
+            return false;
+
+        fullId = sdoFullId(msg);
+        size = (msg.data[0] & 0x01) ? 4 - ((msg.data[0] >> 2) & 0x3) : 4;
+        value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint32_t>(msg.data[4 + i]) << (8 * i);
+        return true;
+    }
+
+    inline void encodeUInt32(uint8_t* data, uint32_t value)
+    {
+        data[0] = value & 0xFF;
+        data[1] = (value >> 8) & 0xFF;
+        data[2] = (value >> 16) & 0xFF;
+        data[3] = (value >> 24) & 0xFF;
+    }
+}
+
+#endif
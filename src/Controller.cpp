@@ -1,10 +1,17 @@
 #include <motors_elmo_ds402/Controller.hpp>
+#include "CANopenProtocol.hpp"
+#include <algorithm>
+#include <fstream>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
 
 using namespace std;
 using namespace motors_elmo_ds402;
 
 Controller::Controller(uint8_t nodeId)
-    : mCanOpen(nodeId)
+    : mNodeId(nodeId)
+    , mCanOpen(nodeId)
     , mRatedTorque(base::unknown<double>())
 {
     setRaw<PositionEncoderResolutionNum>(1);
@@ -17,6 +24,11 @@ Controller::Controller(uint8_t nodeId)
     setRaw<MotorRatedTorque>(1);
 }
 
+uint8_t Controller::getNodeId() const
+{
+    return mNodeId;
+}
+
 void Controller::setRatedTorque(double ratedTorque)
 {
     mRatedTorque = ratedTorque;
@@ -70,7 +82,8 @@ canbus::Message Controller::queryOperationMode() const
 
 OPERATION_MODES Controller::getOperationMode() const
 {
-    return static_cast<OPERATION_MODES>(getRaw<ModesOfOperation>());
+    return static_cast<OPERATION_MODES>(
+        getHotRaw<ModesOfOperation>(mHotObjects.operationMode));
 }
 
 canbus::Message Controller::setOperationMode(OPERATION_MODES mode) const
@@ -83,8 +96,14 @@ canbus::Message Controller::setOperationMode(OPERATION_MODES mode) const
 
 std::vector<canbus::Message> Controller::queryFactors()
 {
-    return std::vector<canbus::Message>
-    {
+    FactorQueries queries;
+    queryFactors(queries);
+    return std::vector<canbus::Message>(queries.begin(), queries.end());
+}
+
+void Controller::queryFactors(FactorQueries& queries) const
+{
+    queries = FactorQueries {{
         queryObject<PositionEncoderResolutionNum>(),
         queryObject<PositionEncoderResolutionDen>(),
         queryObject<GearRatioNum>(),
@@ -95,15 +114,16 @@ std::vector<canbus::Message> Controller::queryFactors()
         queryObject<VelocityFactorDen>(),
         queryObject<MotorRatedCurrent>(),
         queryObject<MotorRatedTorque>()
-    };
+    }};
 }
 
 canbus::Message Controller::setTorqueTarget(double target)
 {
-    if (base::isUnknown(mFactors.ratedTorque))
+    Factors const& factors = getCurrentFactors();
+    if (base::isUnknown(factors.ratedTorque))
         throw std::logic_error("must query or set rated torque before using setTorqueTarget");
 
-    double canopen_target = (target / mFactors.ratedTorque) * 1000;
+    double canopen_target = (target / factors.ratedTorque) * 1000;
     if (canopen_target < -32767 || canopen_target > 32768)
         throw std::out_of_range("torque value out of range");
 
@@ -114,7 +134,12 @@ canbus::Message Controller::setTorqueTarget(double target)
 void Controller::setMotorParameters(MotorParameters const& parameters)
 {
     mMotorParameters = parameters;
+    applyMotorParameters();
+}
 
+void Controller::applyMotorParameters()
+{
+    MotorParameters const& parameters = mMotorParameters;
     if (parameters.encoderTicks)
         setRaw<PositionEncoderResolutionNum>(parameters.encoderTicks);
     if (parameters.encoderRevolutions)
@@ -132,14 +157,29 @@ void Controller::setMotorParameters(MotorParameters const& parameters)
         setRaw<MotorRatedTorque>(current_mA * parameters.torqueConstant);
     }
 
-    try {
-        mFactors = computeFactors();
-    }
-    catch(canopen_master::ObjectNotRead) {}
+    std::lock_guard<std::mutex> lock(mFactorsLock);
+    mFactorsDirty = true;
 }
 
 Factors Controller::getFactors() const
 {
+    return getCurrentFactors();
+}
+
+Factors Controller::getCurrentFactors() const
+{
+    std::lock_guard<std::mutex> lock(mFactorsLock);
+    if (mFactorsDirty)
+    {
+        try {
+            Factors factors = computeFactors();
+            factors.encoderScaleFactor = mFactors.encoderScaleFactor;
+            factors.update();
+            mFactors = factors;
+        }
+        catch(canopen_master::ObjectNotRead) {}
+        mFactorsDirty = false;
+    }
     return mFactors;
 }
 
@@ -163,13 +203,201 @@ Factors Controller::computeFactors() const
         update |= object::UPDATE_ID; \
         break;
 
-#define SDO_UPDATE_CASE(object) \
-    case (static_cast<uint32_t>(object::OBJECT_ID) << 8 | object::OBJECT_SUB_ID): \
-        update |= object::UPDATE_ID; \
-        break;
-
 Update Controller::process(canbus::Message const& msg)
 {
+    Update update = processMessage(msg);
+    processUpdate(update);
+    return update;
+}
+
+Update Controller::process(canbus::Message const* begin, canbus::Message const* end)
+{
+    Update update;
+    for (canbus::Message const* it = begin; it != end; ++it)
+        update.merge(processMessage(*it));
+    processUpdate(update);
+    return update;
+}
+
+Update Controller::process(std::vector<canbus::Message> const& messages)
+{
+    return process(messages.data(), messages.data() + messages.size());
+}
+
+static const uint64_t HOT_UPDATES =
+    UPDATE_JOINT_STATE | UPDATE_STATUS_WORD | UPDATE_OPERATION_MODE |
+    UPDATE_DRIVE_TIMESTAMP;
+
+template<typename T>
+static void encodeLittleEndian(uint8_t* data, T value)
+{
+    typename std::make_unsigned<T>::type raw = value;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        data[i] = (raw >> (8 * i)) & 0xFF;
+}
+
+void Controller::HotTPDO::add(uint64_t updateId, uint8_t objectSize)
+{
+    int8_t offset = size;
+    switch(updateId)
+    {
+        case UPDATE_JOINT_POSITION: positionOffset = offset; break;
+        case UPDATE_JOINT_VELOCITY: velocityOffset = offset; break;
+        case UPDATE_JOINT_CURRENT: currentOffset = offset; break;
+        case UPDATE_STATUS_WORD: statusWordOffset = offset; break;
+        case UPDATE_DRIVE_TIMESTAMP: timestampOffset = offset; break;
+        default:
+            throw std::invalid_argument("object cannot be decoded directly");
+    }
+    size += objectSize;
+    updates |= updateId;
+}
+
+void Controller::declareHotTPDO(int pdoIndex, HotTPDO layout)
+{
+    if (pdoIndex < 0 || pdoIndex >= 4)
+        return;
+
+    // PDOs are configured using the COB-IDs of the predefined connection set
+    layout.canId = TPDO_COB_ID + 0x100 * pdoIndex + mNodeId;
+    mHotTPDOs[pdoIndex] = layout;
+}
+
+Update Controller::processHotTPDO(HotTPDO const& layout, canbus::Message const& msg)
+{
+    Update update = Update::UpdatedObjects(layout.updates, layout.objects);
+
+    // If the PDO contains the drive timestamp, all its objects have been
+    // sampled at that time
+    base::Time time = msg.time;
+    if (layout.timestampOffset >= 0)
+    {
+        mHotObjects.driveTimestamp = decodeUInt32(msg.data + layout.timestampOffset);
+        mDriveClock.update(mHotObjects.driveTimestamp, msg.time);
+        time = mDriveClock.toHostTime(mHotObjects.driveTimestamp);
+        update.setTimestamp(TimestampUsec::OBJECT_ID,
+            TimestampUsec::OBJECT_SUB_ID, time);
+    }
+    if (layout.positionOffset >= 0)
+    {
+        mHotObjects.position = decodeUInt32(msg.data + layout.positionOffset);
+        update.setTimestamp(PositionActualInternalValue::OBJECT_ID,
+            PositionActualInternalValue::OBJECT_SUB_ID, time);
+    }
+    if (layout.velocityOffset >= 0)
+    {
+        mHotObjects.velocity = decodeUInt32(msg.data + layout.velocityOffset);
+        update.setTimestamp(VelocityActualValue::OBJECT_ID,
+            VelocityActualValue::OBJECT_SUB_ID, time);
+    }
+    if (layout.currentOffset >= 0)
+    {
+        mHotObjects.current = decodeUInt16(msg.data + layout.currentOffset);
+        update.setTimestamp(CurrentActualValue::OBJECT_ID,
+            CurrentActualValue::OBJECT_SUB_ID, time);
+    }
+    if (layout.statusWordOffset >= 0)
+    {
+        mHotObjects.statusWord = decodeUInt16(msg.data + layout.statusWordOffset);
+        update.setTimestamp(StatusWord::OBJECT_ID,
+            StatusWord::OBJECT_SUB_ID, time);
+    }
+    mHotObjects.updated |= layout.updates;
+    return update;
+}
+
+Controller::HotRPDO::HotRPDO()
+{
+    frame.can_id = 0;
+    frame.size = 0;
+    fill(frame.data, frame.data + 8, 0);
+    fill(offsets, offsets + RPDO_FIELD_COUNT, -1);
+}
+
+void Controller::HotRPDO::add(HOT_RPDO_FIELDS field, uint8_t objectSize)
+{
+    if (frame.size + objectSize > 8)
+        throw std::invalid_argument("the RPDO mapping does not fit in 8 bytes");
+    offsets[field] = frame.size;
+    frame.size += objectSize;
+}
+
+template<typename T>
+void Controller::initHotRPDOField(HotRPDO& layout, HOT_RPDO_FIELDS field) const
+{
+    if (layout.offsets[field] >= 0 && mCanOpen.has(T::OBJECT_ID, T::OBJECT_SUB_ID))
+        encodeLittleEndian(layout.frame.data + layout.offsets[field], getRaw<T>());
+}
+
+void Controller::declareHotRPDO(int pdoIndex, HotRPDO layout)
+{
+    if (pdoIndex < 0 || pdoIndex >= 4)
+        return;
+
+    initHotRPDOField<ControlWordRegister>(layout, RPDO_CONTROL_WORD);
+    initHotRPDOField<TargetPosition>(layout, RPDO_TARGET_POSITION);
+    initHotRPDOField<TargetVelocity>(layout, RPDO_TARGET_VELOCITY);
+    initHotRPDOField<TargetTorque>(layout, RPDO_TARGET_TORQUE);
+    initHotRPDOField<VelocityOffset>(layout, RPDO_VELOCITY_OFFSET);
+    initHotRPDOField<TorqueOffset>(layout, RPDO_TORQUE_OFFSET);
+
+    layout.frame.can_id = RPDO_COB_ID + 0x100 * pdoIndex + mNodeId;
+    mHotRPDOs[pdoIndex] = layout;
+
+    mHotRPDOFields = 0;
+    for (auto const& pdo : mHotRPDOs)
+    {
+        for (int i = 0; i < RPDO_FIELD_COUNT; ++i)
+        {
+            if (pdo.offsets[i] >= 0)
+                mHotRPDOFields |= 1 << i;
+        }
+    }
+}
+
+template<typename T>
+void Controller::setControlRaw(HOT_RPDO_FIELDS field, typename T::OBJECT_TYPE value)
+{
+    if (!(mHotRPDOFields & (1 << field)))
+    {
+        setRaw<T>(value);
+        return;
+    }
+
+    for (auto& pdo : mHotRPDOs)
+    {
+        if (pdo.offsets[field] >= 0)
+            encodeLittleEndian(pdo.frame.data + pdo.offsets[field], value);
+    }
+}
+
+Update Controller::processMessage(canbus::Message const& msg)
+{
+    for (HotTPDO const& layout : mHotTPDOs)
+    {
+        if (layout.updates && layout.canId == msg.can_id && layout.size <= msg.size)
+            return processHotTPDO(layout, msg);
+    }
+
+    if (msg.can_id == SDO_SERVER_COB_ID + mNodeId && msg.size == 8)
+        processDriveValues(msg);
+
+    if (msg.can_id == SDO_SERVER_COB_ID + mNodeId &&
+        msg.size == 8 && msg.data[0] == SDO_ABORT_COMMAND)
+    {
+        int objectId = msg.data[1] | msg.data[2] << 8;
+        return Update::Abort(objectId, msg.data[3], decodeUInt32(msg.data + 4));
+    }
+
+    // Ack of an upload request. canopen_master does not report them as such,
+    // so we detect them ourselves to allow for tracking SDO transactions
+    Update result;
+    if (msg.can_id == SDO_SERVER_COB_ID + mNodeId && msg.size == 8 &&
+        (msg.data[0] & SDO_COMMAND_MASK) == SDO_INITIATE_UPLOAD_RESPONSE)
+    {
+        result = Update::Ack(msg.data[1] | msg.data[2] << 8, msg.data[3]);
+    }
+
     uint64_t update = 0;
     auto canUpdate = mCanOpen.process(msg);
     switch(canUpdate.mode)
@@ -185,59 +413,70 @@ Update Controller::process(canbus::Message const& msg)
         default: ; // we just ignore the rest, we really don't care
     };
 
+    ObjectSet objects;
     for (auto it = canUpdate.begin(); it != canUpdate.end(); ++it)
     {
         uint32_t fullId = static_cast<uint32_t>(it->first) << 8 | it->second;
-
-        switch(fullId)
+        int index = findObjectIndex(fullId);
+        if (index != -1)
         {
-            SDO_UPDATE_CASE(StatusWord);
-            SDO_UPDATE_CASE(ModesOfOperation);
-
-            // UPDATE_FACTORS
-            SDO_UPDATE_CASE(PositionEncoderResolutionNum);
-            SDO_UPDATE_CASE(PositionEncoderResolutionDen);
-            SDO_UPDATE_CASE(VelocityEncoderResolutionNum);
-            SDO_UPDATE_CASE(VelocityEncoderResolutionDen);
-            SDO_UPDATE_CASE(AccelerationFactorNum);
-            SDO_UPDATE_CASE(AccelerationFactorDen);
-            SDO_UPDATE_CASE(GearRatioNum);
-            SDO_UPDATE_CASE(GearRatioDen);
-            SDO_UPDATE_CASE(FeedConstantNum);
-            SDO_UPDATE_CASE(FeedConstantDen);
-            SDO_UPDATE_CASE(VelocityFactorNum);
-            SDO_UPDATE_CASE(VelocityFactorDen);
-            SDO_UPDATE_CASE(MotorRatedCurrent);
-            SDO_UPDATE_CASE(MotorRatedTorque);
-
-            // UPDATE_JOINT_STATE
-            SDO_UPDATE_CASE(PositionActualInternalValue);
-            SDO_UPDATE_CASE(VelocityActualValue);
-            SDO_UPDATE_CASE(CurrentActualValue);
-
-            // UPDATE_JOINT_LIMITS
-            SDO_UPDATE_CASE(SoftwarePositionLimitMin);
-            SDO_UPDATE_CASE(SoftwarePositionLimitMax);
-            SDO_UPDATE_CASE(MaxMotorSpeed);
-            SDO_UPDATE_CASE(MaxAcceleration);
-            SDO_UPDATE_CASE(MaxDeceleration);
-            SDO_UPDATE_CASE(MaxCurrent);
+            update |= OBJECT_REGISTRY[index].updateId;
+            objects.set(index);
         }
+        result.setTimestamp(it->first, it->second, msg.time);
     }
 
-    if (update & UPDATE_FACTORS) {
-        // If the user explicitely wrote motor parameters, we apply them again
-        // The method re-computed the factors. There's no need to do it
-        // explicitely
-        setMotorParameters(mMotorParameters);
-    }
+    if (update & HOT_UPDATES)
+        updateHotObjects(update);
+
+    result.merge(Update::UpdatedObjects(update, objects));
+    return result;
+}
 
-    return Update::UpdatedObjects(update);
+void Controller::processUpdate(Update const& update)
+{
+    // If the user explicitely wrote motor parameters, we apply them again.
+    // The factors themselves are recomputed the next time they are needed,
+    // which allows to process a complete factor query before computing them
+    if (update.hasOneUpdated(UPDATE_FACTORS))
+        applyMotorParameters();
 }
 
 StatusWord Controller::getStatusWord() const
 {
-    return get<StatusWord>();
+    return parse<StatusWord, uint16_t>(
+        getHotRaw<StatusWord>(mHotObjects.statusWord));
+}
+
+StatusWord Controller::tryGetStatusWord() const
+{
+    return StatusWord::tryParse(getHotRaw<StatusWord>(mHotObjects.statusWord));
+}
+
+void Controller::updateHotObjects(uint64_t update)
+{
+    if (update & UPDATE_JOINT_POSITION)
+        mHotObjects.position = getRaw<PositionActualInternalValue>();
+    if (update & UPDATE_JOINT_VELOCITY)
+        mHotObjects.velocity = getRaw<VelocityActualValue>();
+    if (update & UPDATE_JOINT_CURRENT)
+        mHotObjects.current = getRaw<CurrentActualValue>();
+    if (update & UPDATE_STATUS_WORD)
+        mHotObjects.statusWord = getRaw<StatusWord>();
+    if (update & UPDATE_OPERATION_MODE)
+        mHotObjects.operationMode = getRaw<ModesOfOperation>();
+    if (update & UPDATE_DRIVE_TIMESTAMP)
+        mHotObjects.driveTimestamp = getRaw<TimestampUsec>();
+    mHotObjects.updated |= update & HOT_UPDATES;
+}
+
+template<typename T>
+typename T::OBJECT_TYPE Controller::getHotRaw(typename T::OBJECT_TYPE field) const
+{
+    if (mHotObjects.updated & T::UPDATE_ID)
+        return field;
+    else
+        return getRaw<T>();
 }
 
 template<typename T>
@@ -264,15 +503,28 @@ canbus::Message Controller::queryObject() const
     return mCanOpen.upload(T::OBJECT_ID, T::OBJECT_SUB_ID);
 }
 
+#define CONTROLLER_INSTANTIATE_OBJECT(object_id, object_sub_id, name, type, update_id) \
+    template canbus::Message Controller::queryObject<name>() const; \
+    template type Controller::getRaw<name>() const;
+CANOPEN_OBJECT_LIST(CONTROLLER_INSTANTIATE_OBJECT, CONTROLLER_INSTANTIATE_OBJECT)
+#undef CONTROLLER_INSTANTIATE_OBJECT
+
 std::vector<canbus::Message> Controller::queryJointState() const
+{
+    JointStateQueries queries;
+    queryJointState(queries);
+    return vector<canbus::Message>(queries.begin(), queries.end());
+}
+
+void Controller::queryJointState(JointStateQueries& queries) const
 {
     // NOTE: we don't need to query TorqueActualValue. Given how bot this and
     // CurrentActualValue are encoded, they contain the same value
-    return vector<canbus::Message> {
+    queries = JointStateQueries {{
         queryObject<PositionActualInternalValue>(),
         queryObject<VelocityActualValue>(),
         queryObject<CurrentActualValue>()
-    };
+    }};
 }
 
 int64_t Controller::getZeroPosition() const
@@ -287,51 +539,80 @@ void Controller::setZeroPosition(int64_t base)
 
 int64_t Controller::getRawPosition() const
 {
-    return getRaw<PositionActualInternalValue>();
+    return getHotRaw<PositionActualInternalValue>(mHotObjects.position);
 }
 
 void Controller::setEncoderScaleFactor(double scale)
 {
+    std::lock_guard<std::mutex> lock(mFactorsLock);
     mFactors.encoderScaleFactor = scale;
     mFactors.update();
 }
 
 base::JointState Controller::getJointState(uint64_t fields) const
 {
+    Factors const& factors = getCurrentFactors();
     base::JointState state;
     if (fields & UPDATE_JOINT_POSITION)
     {
-        auto position = getRaw<PositionActualInternalValue>() - mZeroPosition;
-        state.position = mFactors.rawToEncoder(position);
+        auto position = getHotRaw<PositionActualInternalValue>(
+            mHotObjects.position) - mZeroPosition;
+        state.position = factors.rawToEncoder(position);
     }
     if (fields & UPDATE_JOINT_VELOCITY)
     {
-        auto velocity = getRaw<VelocityActualValue>();
-        state.speed    = mFactors.rawToEncoder(velocity);
+        auto velocity = getHotRaw<VelocityActualValue>(mHotObjects.velocity);
+        state.speed    = factors.rawToEncoder(velocity);
     }
     if (fields & UPDATE_JOINT_CURRENT) {
         // See comment in queryJointState
-        auto current_and_torque = getRaw<CurrentActualValue>();
-        state.raw      = mFactors.rawToCurrent(current_and_torque);
-        state.effort   = mFactors.rawToTorque(current_and_torque);
+        auto current_and_torque = getHotRaw<CurrentActualValue>(
+            mHotObjects.current);
+        state.raw      = factors.rawToCurrent(current_and_torque);
+        state.effort   = factors.rawToTorque(current_and_torque);
     }
     return state;
 }
 
 vector<canbus::Message> Controller::queryJointLimits() const
 {
-    return vector<canbus::Message> {
+    JointLimitQueries queries;
+    queryJointLimits(queries);
+    return vector<canbus::Message>(queries.begin(), queries.end());
+}
+
+void Controller::queryJointLimits(JointLimitQueries& queries) const
+{
+    queries = JointLimitQueries {{
         queryObject<SoftwarePositionLimitMin>(),
         queryObject<SoftwarePositionLimitMax>(),
         queryObject<MaxMotorSpeed>(),
         queryObject<MaxAcceleration>(),
         queryObject<MaxDeceleration>(),
         queryObject<MaxCurrent>()
-    };
+    }};
+}
+
+base::Time Controller::getSampleTime() const
+{
+    if (!(mHotObjects.updated & UPDATE_DRIVE_TIMESTAMP))
+        return base::Time();
+    return mDriveClock.toHostTime(mHotObjects.driveTimestamp);
+}
+
+DriveClock const& Controller::getDriveClock() const
+{
+    return mDriveClock;
+}
+
+void Controller::resetDriveClock()
+{
+    mDriveClock.reset();
 }
 
 base::JointLimitRange Controller::getJointLimits() const
 {
+    Factors const& factors = getCurrentFactors();
     base::JointState min;
     base::JointState max;
 
@@ -344,8 +625,8 @@ base::JointLimitRange Controller::getJointLimits() const
     }
     else
     {
-        min.position = mFactors.rawToEncoder(rawPositionMin);
-        max.position = mFactors.rawToEncoder(rawPositionMax);
+        min.position = factors.rawToEncoder(rawPositionMin);
+        max.position = factors.rawToEncoder(rawPositionMax);
     }
 
     int32_t rawMaxSpeed = getRaw<MaxMotorSpeed>();
@@ -356,7 +637,7 @@ base::JointLimitRange Controller::getJointLimits() const
     }
     else
     {
-        double speedLimit = mFactors.rawToEncoder(rawMaxSpeed);
+        double speedLimit = factors.rawToEncoder(rawMaxSpeed);
         min.speed = -speedLimit;
         max.speed = speedLimit;
     }
@@ -365,11 +646,11 @@ base::JointLimitRange Controller::getJointLimits() const
     max.acceleration = base::infinity<double>();
 
     auto torqueAndCurrentLimit = getRaw<MaxCurrent>();
-    double torqueLimit = mFactors.rawToTorque(torqueAndCurrentLimit);
+    double torqueLimit = factors.rawToTorque(torqueAndCurrentLimit);
     min.effort = -torqueLimit;
     max.effort = torqueLimit;
 
-    double currentLimit = mFactors.rawToCurrent(torqueAndCurrentLimit);
+    double currentLimit = factors.rawToCurrent(torqueAndCurrentLimit);
     min.raw = -currentLimit;
     max.raw = currentLimit;
 
@@ -391,42 +672,56 @@ struct PDOMapping : canopen_master::PDOMapping
 
 void Controller::setControlTargets(base::JointState const& targets)
 {
+    Factors const& factors = getCurrentFactors();
     if (targets.hasPosition())
     {
-        int64_t raw = mFactors.rawFromEncoder(targets.position);
-        setRaw<TargetPosition>(raw);
+        int64_t raw = factors.rawFromEncoder(targets.position);
+        setControlRaw<TargetPosition>(RPDO_TARGET_POSITION, raw);
     }
     if (targets.hasSpeed())
     {
-        int64_t raw = mFactors.rawFromEncoder(targets.speed);
-        setRaw<TargetVelocity>(raw);
+        int64_t raw = factors.rawFromEncoder(targets.speed);
+        setControlRaw<TargetVelocity>(RPDO_TARGET_VELOCITY, raw);
     }
     if (targets.hasEffort())
     {
-        int64_t raw = mFactors.rawFromTorque(targets.effort);
-        setRaw<TargetTorque>(raw);
+        int64_t raw = factors.rawFromTorque(targets.effort);
+        setControlRaw<TargetTorque>(RPDO_TARGET_TORQUE, raw);
     }
 }
 
 canbus::Message Controller::getRPDOMessage(unsigned int pdoIndex)
 {
+    if (pdoIndex < 4 && mHotRPDOs[pdoIndex].frame.size != 0)
+        return mHotRPDOs[pdoIndex].frame;
     return mCanOpen.getRPDOMessage(pdoIndex);
 }
 
+canbus::Message const& Controller::getRPDOFrame(unsigned int pdoIndex) const
+{
+    if (pdoIndex >= 4 || mHotRPDOs[pdoIndex].frame.size == 0)
+        throw std::invalid_argument("RPDO has not been configured with configureControlPDO or configureCombinedControlPDO");
+    return mHotRPDOs[pdoIndex].frame;
+}
+
 std::vector<canbus::Message> Controller::configureControlPDO(
     int pdoIndex, base::JointState::MODE control_mode,
     canopen_master::PDOCommunicationParameters parameters)
 {
     PDOMapping mapping;
+    HotRPDO hot;
     switch(control_mode) {
         case base::JointState::POSITION:
             mapping.add<TargetPosition>();
+            hot.add(RPDO_TARGET_POSITION, sizeof(TargetPosition::OBJECT_TYPE));
             break;
         case base::JointState::SPEED:
             mapping.add<TargetVelocity>();
+            hot.add(RPDO_TARGET_VELOCITY, sizeof(TargetVelocity::OBJECT_TYPE));
             break;
         case base::JointState::EFFORT:
             mapping.add<TargetTorque>();
+            hot.add(RPDO_TARGET_TORQUE, sizeof(TargetTorque::OBJECT_TYPE));
             break;
         default:
             throw std::invalid_argument("expected control_mode to be POSITION, SPEED or EFFORT");
@@ -434,60 +729,370 @@ std::vector<canbus::Message> Controller::configureControlPDO(
 
     auto msg = mCanOpen.configurePDO(false, pdoIndex, parameters, mapping);
     mCanOpen.declareRPDOMapping(pdoIndex, mapping);
+    declareHotRPDO(pdoIndex, hot);
     return msg;
 }
 
-std::vector<canbus::Message> Controller::configureStatusPDO(
-    int pdoIndex, canopen_master::PDOCommunicationParameters parameters)
+vector<canbus::Message> Controller::configureCombinedControlPDO(
+    int pdoIndex, OPERATION_MODES mode, int offsets,
+    canopen_master::PDOCommunicationParameters parameters)
 {
     PDOMapping mapping;
-    mapping.add<StatusWord>();
-    auto msg = mCanOpen.configurePDO(true, pdoIndex, parameters, mapping);
-    mCanOpen.declareTPDOMapping(pdoIndex, mapping);
+    HotRPDO hot;
+    mapping.add<ControlWordRegister>();
+    hot.add(RPDO_CONTROL_WORD, sizeof(ControlWordRegister::OBJECT_TYPE));
+    switch(mode) {
+        case OPERATION_MODE_CYCLIC_SYNCHRONOUS_POSITION:
+            mapping.add<TargetPosition>();
+            hot.add(RPDO_TARGET_POSITION, sizeof(TargetPosition::OBJECT_TYPE));
+            break;
+        case OPERATION_MODE_CYCLIC_SYNCHRONOUS_VELOCITY:
+            mapping.add<TargetVelocity>();
+            hot.add(RPDO_TARGET_VELOCITY, sizeof(TargetVelocity::OBJECT_TYPE));
+            break;
+        case OPERATION_MODE_CYCLIC_SYNCHRONOUS_TORQUE:
+            mapping.add<TargetTorque>();
+            hot.add(RPDO_TARGET_TORQUE, sizeof(TargetTorque::OBJECT_TYPE));
+            break;
+        default:
+            throw std::invalid_argument("expected mode to be a cyclic synchronous mode");
+    }
+    // HotRPDO::add throws if the mapping does not fit in 8 bytes
+    if (offsets & CONTROL_PDO_VELOCITY_OFFSET)
+    {
+        mapping.add<VelocityOffset>();
+        hot.add(RPDO_VELOCITY_OFFSET, sizeof(VelocityOffset::OBJECT_TYPE));
+    }
+    if (offsets & CONTROL_PDO_TORQUE_OFFSET)
+    {
+        mapping.add<TorqueOffset>();
+        hot.add(RPDO_TORQUE_OFFSET, sizeof(TorqueOffset::OBJECT_TYPE));
+    }
+
+    auto msg = mCanOpen.configurePDO(false, pdoIndex, parameters, mapping);
+    mCanOpen.declareRPDOMapping(pdoIndex, mapping);
+    declareHotRPDO(pdoIndex, hot);
     return msg;
 }
 
+vector<canbus::Message> Controller::configureInterpolationPeriod(base::Time const& period)
+{
+    // Use the coarsest unit that represents the period exactly, from
+    // seconds down to microseconds
+    int64_t usec = period.toMicroseconds();
+    int64_t unit = 1000000;
+    int index = 0;
+    while (unit > 1 && (usec % unit != 0 || usec / unit > 255))
+    {
+        unit /= 10;
+        --index;
+    }
+    if (usec <= 0 || usec % unit != 0 || usec / unit > 255)
+        throw std::invalid_argument("cannot represent the interpolation period");
+
+    return vector<canbus::Message> {
+        mCanOpen.download(InterpolationTimePeriodValue::OBJECT_ID,
+            InterpolationTimePeriodValue::OBJECT_SUB_ID,
+            static_cast<InterpolationTimePeriodValue::OBJECT_TYPE>(usec / unit)),
+        mCanOpen.download(InterpolationTimeIndex::OBJECT_ID,
+            InterpolationTimeIndex::OBJECT_SUB_ID,
+            static_cast<InterpolationTimeIndex::OBJECT_TYPE>(index))
+    };
+}
+
+void Controller::setControlWord(ControlWord const& controlWord)
+{
+    setControlRaw<ControlWordRegister>(RPDO_CONTROL_WORD,
+        encode<ControlWord, ControlWordRegister::OBJECT_TYPE>(controlWord));
+}
+
+void Controller::setControlOffsets(double velocityOffset, double torqueOffset)
+{
+    Factors const& factors = getCurrentFactors();
+    if (!base::isUnknown(velocityOffset))
+        setControlRaw<VelocityOffset>(RPDO_VELOCITY_OFFSET,
+            factors.rawFromEncoder(velocityOffset));
+    if (!base::isUnknown(torqueOffset))
+        setControlRaw<TorqueOffset>(RPDO_TORQUE_OFFSET,
+            factors.rawFromTorque(torqueOffset));
+}
+
+std::vector<canbus::Message> Controller::configureStatusPDO(
+    int pdoIndex, canopen_master::PDOCommunicationParameters parameters,
+    bool timestamp)
+{
+    ObjectSet objects;
+    objects.add<StatusWord>();
+    if (timestamp)
+        objects.add<TimestampUsec>();
+    return configureTPDOs(pdoIndex, 1, objects, parameters, nullptr);
+}
+
 vector<canbus::Message> Controller::configureJointStateUpdatePDOs(
     int pdoIndex, canopen_master::PDOCommunicationParameters parameters, uint64_t fields)
 {
-    // We need two PDOs only if the three fields are reported. If not, need only
-    // one
-    PDOMapping mapping0;
-    PDOMapping mapping1;
-    if (fields == UPDATE_JOINT_STATE) {
-        mapping0.add<PositionActualInternalValue>();
-        mapping0.add<VelocityActualValue>();
-        mapping1.add<CurrentActualValue>();
-    }
-    else {
-        if (fields & UPDATE_JOINT_POSITION)
-            mapping0.add<PositionActualInternalValue>();
-        if (fields & UPDATE_JOINT_VELOCITY)
-            mapping0.add<VelocityActualValue>();
-        if (fields & UPDATE_JOINT_CURRENT)
-            mapping0.add<CurrentActualValue>();
+    ObjectSet objects;
+    if (fields & UPDATE_JOINT_POSITION)
+        objects.add<PositionActualInternalValue>();
+    if (fields & UPDATE_JOINT_VELOCITY)
+        objects.add<VelocityActualValue>();
+    if (fields & UPDATE_JOINT_CURRENT)
+        objects.add<CurrentActualValue>();
+    if (fields & UPDATE_DRIVE_TIMESTAMP)
+        objects.add<TimestampUsec>();
+    return configureTPDOs(pdoIndex, 2, objects, parameters);
+}
+
+template<typename T>
+static canbus::Message downloadRaw(canopen_master::StateMachine& canopen,
+    ObjectInfo const& object, int64_t value)
+{
+    if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max())
+        throw std::invalid_argument(
+            std::string("value out of range for ") + object.name);
+    return canopen.download(object.id, object.subId, static_cast<T>(value));
+}
+
+canbus::Message Controller::sendRaw(ObjectInfo const& object, int64_t value)
+{
+    if (!object.isWritable())
+        throw std::invalid_argument(std::string(object.name) + " is read-only");
+
+    switch(object.type)
+    {
+        case OBJECT_TYPE_INT8: return downloadRaw<int8_t>(mCanOpen, object, value);
+        case OBJECT_TYPE_UINT8: return downloadRaw<uint8_t>(mCanOpen, object, value);
+        case OBJECT_TYPE_INT16: return downloadRaw<int16_t>(mCanOpen, object, value);
+        case OBJECT_TYPE_UINT16: return downloadRaw<uint16_t>(mCanOpen, object, value);
+        case OBJECT_TYPE_INT32: return downloadRaw<int32_t>(mCanOpen, object, value);
+        case OBJECT_TYPE_UINT32: return downloadRaw<uint32_t>(mCanOpen, object, value);
     }
+    throw std::invalid_argument("unknown object type");
+}
 
-    vector<canbus::Message> messages;
-    if (mapping0.empty()) {
-	messages.push_back(mCanOpen.disablePDO(true, pdoIndex));
+static bool isHotObject(ObjectInfo const& info)
+{
+    switch(info.updateId)
+    {
+        case UPDATE_JOINT_POSITION:
+        case UPDATE_JOINT_VELOCITY:
+        case UPDATE_JOINT_CURRENT:
+        case UPDATE_STATUS_WORD:
+        case UPDATE_DRIVE_TIMESTAMP:
+            return true;
+        default:
+            return false;
     }
-    else {
-        auto pdo = mCanOpen.configurePDO(true, pdoIndex, parameters, mapping0);
-        mCanOpen.declareTPDOMapping(pdoIndex, mapping0);
-        messages.insert(messages.end(), pdo.begin(), pdo.end());
+}
+
+vector<canbus::Message> Controller::configureTPDOs(
+    int pdoIndex, int pdoCount, ObjectSet const& objects,
+    canopen_master::PDOCommunicationParameters parameters)
+{
+    return configureTPDOs(pdoIndex, pdoCount, objects, parameters, nullptr);
+}
+
+/** Converts the event timing into the raw values of the PDO communication
+ * parameters
+ */
+static void getRawEventTiming(TPDOEventTiming const& timing,
+    uint16_t& inhibitTime, uint16_t& eventTimer)
+{
+    // Round the inhibit time up, so that it remains a lower bound
+    int64_t inhibit = (timing.inhibitTime.toMicroseconds() + 99) / 100;
+    int64_t timer = timing.eventTimer.toMilliseconds();
+    if (inhibit < 0 || inhibit > numeric_limits<uint16_t>::max())
+        throw std::invalid_argument("the PDO inhibit time must be between 0 and 6.5535s");
+    if (timer < 0 || timer > numeric_limits<uint16_t>::max())
+        throw std::invalid_argument("the PDO event timer must be between 0 and 65.535s");
+    inhibitTime = inhibit;
+    eventTimer = timer;
+}
+
+vector<canbus::Message> Controller::configureEventTPDOs(
+    int pdoIndex, int pdoCount, ObjectSet const& objects,
+    TPDOEventTiming const& timing)
+{
+    return configureTPDOs(pdoIndex, pdoCount, objects,
+        canopen_master::PDOCommunicationParameters::Async(), &timing);
+}
+
+vector<canbus::Message> Controller::configureJointStateEventPDOs(
+    int pdoIndex, TPDOEventTiming const& timing, uint64_t fields)
+{
+    ObjectSet objects;
+    if (fields & UPDATE_JOINT_POSITION)
+        objects.add<PositionActualInternalValue>();
+    if (fields & UPDATE_JOINT_VELOCITY)
+        objects.add<VelocityActualValue>();
+    if (fields & UPDATE_JOINT_CURRENT)
+        objects.add<CurrentActualValue>();
+    if (fields & UPDATE_DRIVE_TIMESTAMP)
+        objects.add<TimestampUsec>();
+    return configureEventTPDOs(pdoIndex, 2, objects, timing);
+}
+
+/** Whether a TPDO is sent when its content changes, instead of on SYNC or
+ * periodically
+ */
+static bool isSentOnChange(canopen_master::PDOCommunicationParameters const& parameters)
+{
+    return parameters.transmission_mode == canopen_master::PDO_ASYNCHRONOUS &&
+        parameters.timer_period.isNull();
+}
+
+vector<canbus::Message> Controller::configureTPDOs(
+    int pdoIndex, int pdoCount, ObjectSet const& objects,
+    canopen_master::PDOCommunicationParameters parameters,
+    TPDOEventTiming const* timing)
+{
+    // The timestamp changes at every sample, so the drive would send the
+    // PDO at every sample
+    if (objects.contains<TimestampUsec>() && isSentOnChange(parameters))
+        throw std::invalid_argument(
+            "the drive timestamp cannot be sent through a TPDO that is sent on change");
+
+    uint16_t inhibitTime = 0, eventTimer = 0;
+    if (timing)
+        getRawEventTiming(*timing, inhibitTime, eventTimer);
+
+    vector<int> indexes;
+    for (size_t i = 0; i < OBJECT_REGISTRY_SIZE; ++i)
+    {
+        if (!objects.test(i))
+            continue;
+        else if (!OBJECT_REGISTRY[i].isReadable())
+            throw std::invalid_argument(
+                string(OBJECT_REGISTRY[i].name) + " is not readable");
+        indexes.push_back(i);
     }
-    if (mapping1.empty()) {
-	messages.push_back(mCanOpen.disablePDO(true, pdoIndex + 1));
+
+    // First-fit decreasing. Objects of the same size stay in registry order
+    std::stable_sort(indexes.begin(), indexes.end(), [](int a, int b) {
+        return getObjectTypeSize(OBJECT_REGISTRY[a].type) >
+            getObjectTypeSize(OBJECT_REGISTRY[b].type);
+    });
+
+    struct Bin
+    {
+        PDOMapping mapping;
+        HotTPDO hot;
+        bool allHot = true;
+        size_t size = 0;
+    };
+    vector<Bin> bins;
+    for (int index : indexes)
+    {
+        ObjectInfo const& info = OBJECT_REGISTRY[index];
+        size_t size = getObjectTypeSize(info.type);
+        auto bin = find_if(bins.begin(), bins.end(), [size](Bin const& b) {
+            return b.size + size <= 8;
+        });
+        if (bin == bins.end())
+        {
+            if (static_cast<int>(bins.size()) == pdoCount)
+                throw std::invalid_argument("the objects do not fit in the PDOs");
+            bins.push_back(Bin());
+            bin = bins.end() - 1;
+        }
+
+        bin->mapping.canopen_master::PDOMapping::add(info.id, info.subId, size);
+        bin->size += size;
+        if (isHotObject(info))
+        {
+            bin->hot.add(info.updateId, size);
+            bin->hot.objects.set(index);
+        }
+        else
+            bin->allHot = false;
     }
-    else {
-        auto pdo = mCanOpen.configurePDO(true, pdoIndex + 1, parameters, mapping1);
-        mCanOpen.declareTPDOMapping(pdoIndex + 1, mapping1);
+
+    vector<canbus::Message> messages;
+    for (int i = 0; i < pdoCount; ++i)
+    {
+        if (i >= static_cast<int>(bins.size()))
+        {
+            declareHotTPDO(pdoIndex + i, HotTPDO());
+            messages.push_back(mCanOpen.disablePDO(true, pdoIndex + i));
+            continue;
+        }
+
+        Bin const& bin = bins[i];
+        declareHotTPDO(pdoIndex + i, bin.allHot ? bin.hot : HotTPDO());
+        auto pdo = mCanOpen.configurePDO(true, pdoIndex + i, parameters, bin.mapping);
+        mCanOpen.declareTPDOMapping(pdoIndex + i, bin.mapping);
         messages.insert(messages.end(), pdo.begin(), pdo.end());
+        if (!timing)
+            continue;
+
+        // The inhibit time can only be changed while the PDO is disabled.
+        // Do it after configurePDO so that its own writes of the
+        // communication parameters do not override ours
+        int parametersId = TPDO_PARAMETERS + pdoIndex + i;
+        uint32_t cobId = TPDO_COB_ID + 0x100 * (pdoIndex + i) + mNodeId;
+        messages.push_back(mCanOpen.download<uint32_t>(
+            parametersId, PDO_COB_ID_SUB_ID, cobId | PDO_COB_ID_INVALID));
+        messages.push_back(mCanOpen.download<uint16_t>(
+            parametersId, PDO_INHIBIT_TIME_SUB_ID, inhibitTime));
+        messages.push_back(mCanOpen.download<uint16_t>(
+            parametersId, PDO_EVENT_TIMER_SUB_ID, eventTimer));
+        messages.push_back(mCanOpen.download<uint32_t>(parametersId, 1, cobId));
     }
     return messages;
 }
 
+void Controller::setJointStateDeadband(base::JointState const& deadband)
+{
+    Factors const& factors = getCurrentFactors();
+    RawDeadband raw;
+    if (deadband.hasPosition())
+        raw.position = std::abs(factors.rawFromEncoder(deadband.position));
+    if (deadband.hasSpeed())
+        raw.velocity = std::abs(factors.rawFromEncoder(deadband.speed));
+    if (deadband.hasEffort())
+        raw.current = std::abs(factors.rawFromTorque(deadband.effort));
+    mDeadband = raw;
+}
+
+static bool isWithin(int64_t value, int64_t reference, int64_t threshold)
+{
+    return std::abs(value - reference) <= threshold;
+}
+
+bool Controller::isInDeadband(canbus::Message const& msg) const
+{
+    for (HotTPDO const& layout : mHotTPDOs)
+    {
+        if (!layout.updates || layout.canId != msg.can_id || layout.size > msg.size)
+            continue;
+
+        // Samples are significant until a first one has been processed.
+        // The drive timestamp is always different, so it is ignored unless
+        // it is alone in the PDO
+        if ((mHotObjects.updated & layout.updates) != layout.updates ||
+            layout.updates == UPDATE_DRIVE_TIMESTAMP)
+            return false;
+
+        if (layout.positionOffset >= 0 && !isWithin(
+                static_cast<int32_t>(decodeUInt32(msg.data + layout.positionOffset)),
+                mHotObjects.position, mDeadband.position))
+            return false;
+        if (layout.velocityOffset >= 0 && !isWithin(
+                static_cast<int32_t>(decodeUInt32(msg.data + layout.velocityOffset)),
+                mHotObjects.velocity, mDeadband.velocity))
+            return false;
+        if (layout.currentOffset >= 0 && !isWithin(
+                static_cast<int16_t>(decodeUInt16(msg.data + layout.currentOffset)),
+                mHotObjects.current, mDeadband.current))
+            return false;
+        if (layout.statusWordOffset >= 0 &&
+            decodeUInt16(msg.data + layout.statusWordOffset) != mHotObjects.statusWord)
+            return false;
+        return true;
+    }
+    return false;
+}
+
 canbus::Message Controller::querySave()
 {
     uint8_t buffer[4] = { 's', 'a', 'v', 'e' };
@@ -499,3 +1104,275 @@ canbus::Message Controller::queryLoad()
     uint8_t buffer[4] = { 'l', 'o', 'a', 'd' };
     return mCanOpen.download(0x1011, 1, buffer, 4);
 }
+
+void Controller::processDriveValues(canbus::Message const& msg)
+{
+    uint8_t command = msg.data[0];
+    if (command == SDO_ABORT_COMMAND)
+    {
+        // The drive value is not known anymore
+        uint32_t fullId = sdoFullId(msg);
+        if (matchPendingDriveValue(fullId))
+            mPendingDriveValues.pop_front();
+        mDriveValues.erase(fullId);
+    }
+    else if (command == SDO_INITIATE_DOWNLOAD_RESPONSE)
+    {
+        uint32_t fullId = sdoFullId(msg);
+        if (matchPendingDriveValue(fullId))
+        {
+            mDriveValues[fullId] = mPendingDriveValues.front().second;
+            mPendingDriveValues.pop_front();
+        }
+        else
+        {
+            // Written outside of diffApply, we don't know the value
+            mDriveValues.erase(fullId);
+        }
+    }
+    else if ((command & SDO_COMMAND_MASK) == SDO_INITIATE_UPLOAD_RESPONSE)
+    {
+        uint32_t fullId;
+        DriveValue value;
+        if (decodeExpedited(msg, fullId, value.value, value.size))
+            mDriveValues[fullId] = value;
+    }
+}
+
+bool Controller::matchPendingDriveValue(uint32_t fullId)
+{
+    // The drive answers the SDO requests in the order they are sent. The
+    // requests pending before the one that matches never got an answer
+    // (e.g. they timed out), so whether the drive applied them is unknown
+    auto it = mPendingDriveValues.begin();
+    for (; it != mPendingDriveValues.end(); ++it)
+    {
+        if (it->first == fullId)
+            break;
+    }
+    if (it == mPendingDriveValues.end())
+        return false;
+
+    for (auto lost = mPendingDriveValues.begin(); lost != it; ++lost)
+        mDriveValues.erase(lost->first);
+    mPendingDriveValues.erase(mPendingDriveValues.begin(), it);
+    return true;
+}
+
+/** Returns the key used to group the downloads in diffApply
+ *
+ * The communication and mapping parameters of a given PDO are in the same
+ * group. Other objects are grouped by themselves.
+ */
+static uint32_t diffApplyGroup(uint32_t fullId)
+{
+    uint16_t objectId = fullId >> 8;
+    if (isPDOParameters(objectId))
+        return (objectId & ~PDO_MAPPING_OFFSET) << 8;
+    else
+        return fullId;
+}
+
+static bool isExpeditedDownload(canbus::Message const& msg, uint8_t nodeId)
+{
+    return msg.can_id == SDO_CLIENT_COB_ID + nodeId && msg.size == 8 &&
+        (msg.data[0] & SDO_COMMAND_MASK) == SDO_INITIATE_DOWNLOAD_REQUEST &&
+        (msg.data[0] & SDO_EXPEDITED);
+}
+
+vector<canbus::Message> Controller::queryDriveValues(
+    vector<canbus::Message> const& messages) const
+{
+    vector<canbus::Message> queries;
+    vector<uint32_t> queried;
+    for (auto const& msg : messages)
+    {
+        if (!isExpeditedDownload(msg, mNodeId))
+            continue;
+
+        uint32_t fullId = sdoFullId(msg);
+        if (mDriveValues.count(fullId) ||
+            find(queried.begin(), queried.end(), fullId) != queried.end())
+            continue;
+
+        queried.push_back(fullId);
+        queries.push_back(mCanOpen.upload(fullId >> 8, fullId & 0xFF));
+    }
+    return queries;
+}
+
+vector<canbus::Message> Controller::diffApply(vector<canbus::Message> const& messages)
+{
+    // Final value of each object written by the messages, and the groups
+    // that need to be sent
+    map<uint32_t, DriveValue> finalValues;
+    for (auto const& msg : messages)
+    {
+        uint32_t fullId;
+        DriveValue value;
+        if (isExpeditedDownload(msg, mNodeId) &&
+            decodeExpedited(msg, fullId, value.value, value.size))
+            finalValues[fullId] = value;
+    }
+
+    map<uint32_t, bool> changedGroups;
+    for (auto const& entry : finalValues)
+    {
+        auto known = mDriveValues.find(entry.first);
+        bool changed = (known == mDriveValues.end() || !(known->second == entry.second));
+        bool& groupChanged = changedGroups[diffApplyGroup(entry.first)];
+        groupChanged = groupChanged || changed;
+    }
+
+    vector<canbus::Message> result;
+    for (auto const& msg : messages)
+    {
+        uint32_t fullId;
+        DriveValue value;
+        if (!isExpeditedDownload(msg, mNodeId) ||
+            !decodeExpedited(msg, fullId, value.value, value.size))
+        {
+            result.push_back(msg);
+            continue;
+        }
+
+        if (changedGroups[diffApplyGroup(fullId)])
+        {
+            result.push_back(msg);
+            mPendingDriveValues.push_back(make_pair(fullId, value));
+        }
+    }
+    return result;
+}
+
+void Controller::clearDriveValues()
+{
+    mDriveValues.clear();
+    mPendingDriveValues.clear();
+}
+
+vector<canbus::Message> Controller::queryIdentity() const
+{
+    return vector<canbus::Message> {
+        queryObject<VendorID>(),
+        queryObject<ProductCode>(),
+        queryObject<RevisionNumber>(),
+        queryObject<IdentityObject>()
+    };
+}
+
+DriveIdentity Controller::getIdentity() const
+{
+    DriveIdentity identity;
+    identity.vendorId = getRaw<VendorID>();
+    identity.productCode = getRaw<ProductCode>();
+    identity.revisionNumber = getRaw<RevisionNumber>();
+    identity.serialNumber = getRaw<IdentityObject>();
+    return identity;
+}
+
+static const char* CONFIGURATION_CACHE_MAGIC = "motors_elmo_ds402-cache";
+static const int CONFIGURATION_CACHE_VERSION = 1;
+
+/** Whether a drive value is part of the configuration cache
+ *
+ * The cache contains the factors, the joint limits and the PDO parameters
+ */
+static bool isCachedObject(uint32_t fullId)
+{
+    int index = findObjectIndex(fullId);
+    if (index != -1)
+        return OBJECT_REGISTRY[index].updateId & (UPDATE_FACTORS | UPDATE_JOINT_LIMITS);
+
+    return isPDOParameters(fullId >> 8);
+}
+
+void Controller::saveConfigurationCache(std::string const& path) const
+{
+    DriveIdentity identity = getIdentity();
+
+    ofstream file(path.c_str());
+    file << CONFIGURATION_CACHE_MAGIC << " " << CONFIGURATION_CACHE_VERSION << "\n";
+    file << hex;
+    file << "identity " << identity.vendorId << " " << identity.productCode << " "
+        << identity.revisionNumber << " " << identity.serialNumber << "\n";
+    for (auto const& entry : mDriveValues)
+    {
+        if (!isCachedObject(entry.first))
+            continue;
+
+        file << (entry.first >> 8) << " " << (entry.first & 0xFF) << " "
+            << static_cast<int>(entry.second.size) << " "
+            << entry.second.value << "\n";
+    }
+    if (!file)
+        throw std::runtime_error("failed to write configuration cache " + path);
+}
+
+bool Controller::loadConfigurationCache(std::string const& path)
+{
+    ifstream file(path.c_str());
+    string magic;
+    int version;
+    if (!(file >> magic >> version) || magic != CONFIGURATION_CACHE_MAGIC ||
+        version != CONFIGURATION_CACHE_VERSION)
+        return false;
+
+    string keyword;
+    DriveIdentity identity;
+    file >> hex;
+    if (!(file >> keyword >> identity.vendorId >> identity.productCode
+                >> identity.revisionNumber >> identity.serialNumber) ||
+        keyword != "identity" || !(identity == getIdentity()))
+        return false;
+
+    vector<pair<uint32_t, DriveValue>> values;
+    uint32_t objectId, subId, size, value;
+    while (file >> objectId >> subId >> size >> value)
+    {
+        if (objectId > 0xFFFF || subId > 0xFF || size < 1 || size > 4)
+            return false;
+        values.push_back(make_pair(objectId << 8 | subId,
+            DriveValue { value, static_cast<uint8_t>(size) }));
+    }
+    if (!file.eof())
+        return false;
+
+    for (auto const& entry : values)
+    {
+        mDriveValues[entry.first] = entry.second;
+        setDictionaryValue(entry.first, entry.second.value);
+    }
+    applyMotorParameters();
+    return true;
+}
+
+void Controller::setDictionaryValue(uint32_t fullId, uint32_t value)
+{
+    int index = findObjectIndex(fullId);
+    if (index == -1)
+        return;
+
+    ObjectInfo const& info = OBJECT_REGISTRY[index];
+    switch(info.type)
+    {
+        case OBJECT_TYPE_INT8:
+            mCanOpen.set<int8_t>(info.id, info.subId, value);
+            break;
+        case OBJECT_TYPE_UINT8:
+            mCanOpen.set<uint8_t>(info.id, info.subId, value);
+            break;
+        case OBJECT_TYPE_INT16:
+            mCanOpen.set<int16_t>(info.id, info.subId, value);
+            break;
+        case OBJECT_TYPE_UINT16:
+            mCanOpen.set<uint16_t>(info.id, info.subId, value);
+            break;
+        case OBJECT_TYPE_INT32:
+            mCanOpen.set<int32_t>(info.id, info.subId, value);
+            break;
+        case OBJECT_TYPE_UINT32:
+            mCanOpen.set<uint32_t>(info.id, info.subId, value);
+            break;
+    }
+}
@@ -3,15 +3,55 @@
 
 #include <canopen_master/StateMachine.hpp>
 #include <motors_elmo_ds402/Objects.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
 #include <motors_elmo_ds402/Update.hpp>
 #include <motors_elmo_ds402/Factors.hpp>
 #include <motors_elmo_ds402/MotorParameters.hpp>
+#include <motors_elmo_ds402/DriveClock.hpp>
 #include <base/JointState.hpp>
 #include <base/JointLimitRange.hpp>
+#include <array>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
 
 namespace motors_elmo_ds402 {
     struct HasPendingQuery : public std::runtime_error {};
 
+    /** Identification of a drive, as read from the identity object (0x1018)
+     *
+     * The serial number is the IdentityObject object
+     */
+    struct DriveIdentity
+    {
+        uint32_t vendorId = 0;
+        uint32_t productCode = 0;
+        uint32_t revisionNumber = 0;
+        uint32_t serialNumber = 0;
+
+        bool operator ==(DriveIdentity const& other) const
+        {
+            return vendorId == other.vendorId &&
+                productCode == other.productCode &&
+                revisionNumber == other.revisionNumber &&
+                serialNumber == other.serialNumber;
+        }
+    };
+
+    /** Timing of event-driven TPDOs, see Controller::configureEventTPDOs */
+    struct TPDOEventTiming
+    {
+        /** Minimum time between two transmissions of the PDO, with a
+         * resolution of 100us. Zero disables it.
+         */
+        base::Time inhibitTime;
+        /** Time after which the PDO is sent even if it did not change,
+         * with a resolution of 1ms. Zero disables it.
+         */
+        base::Time eventTimer;
+    };
+
     /** Representation of a controller through the CANOpen protocol
      *
      * This is designed to be independent of _how_ the CAN bus
@@ -23,8 +63,18 @@ namespace motors_elmo_ds402 {
         typedef canopen_master::StateMachine StateMachine;
 
     public:
+        /** Fixed-size set of messages returned by queryFactors */
+        typedef std::array<canbus::Message, 10> FactorQueries;
+        /** Fixed-size set of messages returned by queryJointState */
+        typedef std::array<canbus::Message, 3> JointStateQueries;
+        /** Fixed-size set of messages returned by queryJointLimits */
+        typedef std::array<canbus::Message, 6> JointLimitQueries;
+
         Controller(uint8_t nodeId);
 
+        /** The ID of the node this controller talks to */
+        uint8_t getNodeId() const;
+
         /** Give the motor rated torque
          *
          * This is necessary to use torque commands and status
@@ -67,9 +117,19 @@ namespace motors_elmo_ds402 {
 
         /**
          * Return the last received status word
+         *
+         * @throw StatusWord::UnknownState if the state bits are invalid
          */
         StatusWord getStatusWord() const;
 
+        /**
+         * Return the last received status word, without throwing if the state
+         * bits are invalid
+         *
+         * @see StatusWord::tryParse
+         */
+        StatusWord tryGetStatusWord() const;
+
         /** Message to query the current operation mode */
         canbus::Message queryOperationMode() const;
 
@@ -87,16 +147,59 @@ namespace motors_elmo_ds402 {
          */
         std::vector<canbus::Message> queryFactors();
 
+        /** Fills \c queries with the SDO upload queries that allow to update
+         * the factor objects
+         *
+         * Unlike the vector-returning version, it does not allocate
+         */
+        void queryFactors(FactorQueries& queries) const;
+
         /**
          * Returns the conversion factor object between Elmo's internal units
          * and physical units
          *
-         * This is a cached object that is updated every time the corresponding
-         * SDOs are uploaded. All factors can be queried by sending the messages
-         * returned by queryFactors.
+         * This is a cached object that is recomputed on demand after the
+         * corresponding SDOs are uploaded. All factors can be queried by
+         * sending the messages returned by queryFactors.
          */
         Factors getFactors() const;
 
+        /** Return the set of SDO upload queries that allow to read the
+         * drive identity
+         */
+        std::vector<canbus::Message> queryIdentity() const;
+
+        /** Return the drive identity
+         *
+         * The objects must have been read with queryIdentity() beforehand
+         */
+        DriveIdentity getIdentity() const;
+
+        /** Save the known configuration of the drive to a cache file
+         *
+         * The cache contains the factors, the joint limits and the PDO
+         * parameters, that is the corresponding drive values (see
+         * diffApply). It is tagged with the drive identity, which must have
+         * been read with queryIdentity() beforehand.
+         *
+         * @throw std::runtime_error if the file cannot be written
+         */
+        void saveConfigurationCache(std::string const& path) const;
+
+        /** Load a cache file written by saveConfigurationCache
+         *
+         * The identity of the drive must have been read with
+         * queryIdentity() beforehand. The cache is only loaded if it has
+         * been saved for a drive with the same identity. Loading it is
+         * equivalent to uploading the cached objects: the factors and joint
+         * limits are available right away, and diffApply skips the PDO
+         * configuration that matches the cache.
+         *
+         * @return false if the file does not exist, is invalid or was
+         *   saved for a different drive. Nothing is loaded in this case.
+         */
+        bool loadConfigurationCache(std::string const& path);
+
         /** Explicitely sets motor parameters
          *
          * The CANOpen objects that store the factors are not saved to non-volatile
@@ -108,8 +211,10 @@ namespace motors_elmo_ds402 {
          * from the current value.
          *
          * This allows to set the parameters that can't be extracted from the
-         * drive, updating the internal factors in the process. One usually
-         * wants to read the factors from the drive beforehand with queryFactors().
+         * drive, updating the object dictionary in the process. The
+         * parameters are written again when the drive sends new factor
+         * values. One usually wants to read the factors from the drive
+         * beforehand with queryFactors().
          */
         void setMotorParameters(MotorParameters const& parameters);
 
@@ -118,6 +223,13 @@ namespace motors_elmo_ds402 {
          */
         std::vector<canbus::Message> queryJointState() const;
 
+        /** Fills \c queries with the SDO upload queries that allow to update
+         * the joint state
+         *
+         * Unlike the vector-returning version, it does not allocate
+         */
+        void queryJointState(JointStateQueries& queries) const;
+
         /**
          * Reads the factor objects from the object dictionary and return them
          */
@@ -128,6 +240,13 @@ namespace motors_elmo_ds402 {
          */
         std::vector<canbus::Message> queryJointLimits() const;
 
+        /** Fills \c queries with the SDO upload queries that allow to get
+         * the current joint limits
+         *
+         * Unlike the vector-returning version, it does not allocate
+         */
+        void queryJointLimits(JointLimitQueries& queries) const;
+
         /**
          * Reads the joint limits from the object dictionary and return them
          */
@@ -141,6 +260,14 @@ namespace motors_elmo_ds402 {
 
         /**
          * Configure the controller to send joint state information through PDOs
+         *
+         * It uses the PDOs pdoIndex and pdoIndex + 1. See configureTPDOs
+         *
+         * The resulting PDOs are decoded directly into the cached joint state
+         * by process(), which bypasses the object dictionary. get() and
+         * timestamp() are therefore not updated by these PDOs, use
+         * getJointState(), getRawPosition() and the timestamps of Update
+         * instead.
          */
         std::vector<canbus::Message> configureJointStateUpdatePDOs(
             int pdoIndex,
@@ -148,13 +275,164 @@ namespace motors_elmo_ds402 {
                 canopen_master::PDOCommunicationParameters::Sync(1),
             uint64_t fields = UPDATE_JOINT_STATE);
 
+        /**
+         * Configure the controller to send a set of objects through TPDOs
+         *
+         * The objects are packed in as few 8-byte PDOs as possible, using
+         * PDOs pdoIndex to pdoIndex + pdoCount - 1. The PDOs of this range
+         * that are not needed are disabled.
+         *
+         * The PDOs that contain only objects of the joint state and the
+         * status word are decoded directly by process(), as with
+         * configureJointStateUpdatePDOs. The others go through the object
+         * dictionary.
+         *
+         * @throw std::invalid_argument if an object is not readable, if the
+         *   objects do not fit in pdoCount PDOs, or if they contain the
+         *   drive timestamp (TimestampUsec) and the PDOs are sent when their
+         *   content changes. The timestamp changes at every sample.
+         */
+        std::vector<canbus::Message> configureTPDOs(
+            int pdoIndex, int pdoCount, ObjectSet const& objects,
+            canopen_master::PDOCommunicationParameters parameters =
+                canopen_master::PDOCommunicationParameters::Sync(1));
+
+        /**
+         * Configure the controller to send a set of objects through
+         * event-driven TPDOs
+         *
+         * The objects are packed as in configureTPDOs, but the drive sends
+         * a PDO only when its content changes, at most once per inhibit time
+         * and at least once per event timer period. Idle axes then use
+         * almost no bandwidth. Use isInDeadband() to also skip the samples
+         * that did not change significantly on the host side.
+         *
+         * @throw std::invalid_argument in the same cases as configureTPDOs,
+         *   which excludes the drive timestamp, or if the timing does not
+         *   fit the CANopen objects (6.5535s for the inhibit time, 65.535s
+         *   for the event timer)
+         */
+        std::vector<canbus::Message> configureEventTPDOs(
+            int pdoIndex, int pdoCount, ObjectSet const& objects,
+            TPDOEventTiming const& timing);
+
+        /**
+         * Configure the controller to send joint state information through
+         * event-driven TPDOs
+         *
+         * It uses the PDOs pdoIndex and pdoIndex + 1, as
+         * configureJointStateUpdatePDOs. See configureEventTPDOs
+         */
+        std::vector<canbus::Message> configureJointStateEventPDOs(
+            int pdoIndex, TPDOEventTiming const& timing,
+            uint64_t fields = UPDATE_JOINT_STATE);
+
+        /** Sets the thresholds used by isInDeadband
+         *
+         * The position, speed and effort fields are in the units of
+         * getJointState. Unset fields have a zero threshold, that is only
+         * samples that did not change at all are within the deadband. The
+         * factors must be known, see queryFactors and setMotorParameters.
+         */
+        void setJointStateDeadband(base::JointState const& deadband);
+
+        /** Whether a message is a TPDO decoded directly by process() whose
+         * content is within the deadband of the values last processed
+         *
+         * Such messages can be dropped instead of being passed to
+         * process(), which then does not update the joint state nor its
+         * timestamps. Any change of the status word is significant, and
+         * the drive timestamp is ignored. The deadband is relative to the
+         * last processed sample, so that slow drifts are eventually
+         * reported.
+         */
+        bool isInDeadband(canbus::Message const& msg) const;
+
         /**
          * Configure the controller to send status words through PDOs
+         *
+         * As with configureJointStateUpdatePDOs, the resulting PDOs are
+         * decoded directly by process() and only update getStatusWord()
+         *
+         * @param timestamp if true, the drive timestamp (TimestampUsec) is
+         *   sent along with the status word, see getSampleTime(). The PDO
+         *   must then be synchronous or periodic, not the default Async()
+         * @throw std::invalid_argument in the same cases as configureTPDOs
          */
         std::vector<canbus::Message> configureStatusPDO(
             int pdoIndex,
             canopen_master::PDOCommunicationParameters parameters =
-                canopen_master::PDOCommunicationParameters::Async());
+                canopen_master::PDOCommunicationParameters::Async(),
+            bool timestamp = false);
+
+        /** Returns the host time at which the drive sampled the data of the
+         * last TPDO that contained its timestamp
+         *
+         * The drive timestamp (TimestampUsec) is mapped in a TPDO by
+         * configureStatusPDO, or by the joint state PDO configurations when
+         * the fields contain UPDATE_DRIVE_TIMESTAMP. It is converted into
+         * host time by the estimator returned by getDriveClock(). The
+         * timestamps of the Update returned by process() for such a TPDO
+         * are the sampling time as well, instead of the reception time.
+         * Since the timestamp changes at every sample, it cannot be mapped
+         * in a TPDO that is sent when its content changes.
+         *
+         * @return a null time if no timestamp has been received yet
+         */
+        base::Time getSampleTime() const;
+
+        /** The estimator that converts the drive timestamps into host time */
+        DriveClock const& getDriveClock() const;
+
+        /** Reset the drive clock estimation
+         *
+         * It must be called when the drive is restarted, as its clock then
+         * restarts from zero
+         */
+        void resetDriveClock();
+
+        /** Returns the SDO upload queries necessary for diffApply to know
+         * the drive value of all the objects written by \c messages
+         *
+         * Objects whose drive value is already known are not queried
+         */
+        std::vector<canbus::Message> queryDriveValues(
+            std::vector<canbus::Message> const& messages) const;
+
+        /** Removes from \c messages the SDO downloads that would not change
+         * the drive's configuration
+         *
+         * The drive values are the values read through expedited SDO uploads
+         * and the values written by downloads returned by this method, once
+         * the drive acknowledged them. Use queryDriveValues to read the
+         * values that are not yet known.
+         *
+         * Since a download ack does not carry the written value, acks are
+         * matched with the returned downloads in order. The downloads must
+         * therefore be sent in the order in which they are returned. If some
+         * of them end up not being sent, call clearDriveValues().
+         *
+         * The downloads to the communication and mapping parameters of a
+         * given PDO are kept or removed together, since these sequences write
+         * the same objects more than once (e.g. to disable the PDO during
+         * reconfiguration). They are removed only if the final value of all
+         * the objects matches the drive value. Other downloads are filtered
+         * individually. Messages that are not expedited SDO downloads are
+         * always kept.
+         *
+         * This applies to the output of configureJointStateUpdatePDOs,
+         * configureStatusPDO and configureControlPDO. setMotorParameters
+         * does not write to the drive.
+         */
+        std::vector<canbus::Message> diffApply(
+            std::vector<canbus::Message> const& messages);
+
+        /** Forget the known drive values
+         *
+         * Call this when the drive configuration changes outside of
+         * diffApply, for instance after a reset or queryLoad
+         */
+        void clearDriveValues();
 
         template<typename T>
         canbus::Message send(T const& object)
@@ -163,10 +441,35 @@ namespace motors_elmo_ds402 {
                 encode<T, typename T::OBJECT_TYPE>(object));
         }
 
+        /** Download a raw value to an object of the registry
+         *
+         * @throw std::invalid_argument if the object is not writable, or if
+         *   the value is out of the range of the object's type
+         */
+        canbus::Message sendRaw(ObjectInfo const& object, int64_t value);
+
         /** Process a can message and returns what got updated
+         *
+         * The returned update is an ack (Update::isAck) if the message
+         * completes an SDO transfer, that is an upload or a download.
          */
         Update process(canbus::Message const& msg);
 
+        /** Process a batch of can messages and returns what got updated
+         *
+         * This is equivalent to calling process(canbus::Message const&) on
+         * each message and merging the results, but the factors are
+         * recomputed at most once for the whole batch. The returned update
+         * contains the acks of all the messages.
+         */
+        Update process(canbus::Message const* begin, canbus::Message const* end);
+
+        /** Process a batch of can messages and returns what got updated
+         *
+         * @see process(canbus::Message const*, canbus::Message const*)
+         */
+        Update process(std::vector<canbus::Message> const& messages);
+
         /** Save configuration to non-volatile memory */
         canbus::Message querySave();
 
@@ -186,6 +489,11 @@ namespace motors_elmo_ds402 {
          *
          * They are not sent to the device. Use PDOs or updateTarget to
          * write them on the device
+         *
+         * Targets that are mapped in a RPDO configured with
+         * configureControlPDO or configureCombinedControlPDO are encoded
+         * directly in the RPDO frame (see getRPDOFrame) instead of the
+         * object dictionary
          */
         void setControlTargets(base::JointState const& setpoint);
 
@@ -198,15 +506,100 @@ namespace motors_elmo_ds402 {
             canopen_master::PDOCommunicationParameters parameters =
                 canopen_master::PDOCommunicationParameters::Async());
 
+        /** Optional offsets of configureCombinedControlPDO */
+        enum CONTROL_PDO_OFFSETS
+        {
+            CONTROL_PDO_VELOCITY_OFFSET = 1,
+            CONTROL_PDO_TORQUE_OFFSET = 2
+        };
+
+        /** Returns the CAN messages necessary to configure a RPDO that
+         * carries the control word, the target of a cyclic synchronous mode
+         * and optionally the velocity and torque offsets
+         *
+         * This allows to send both the state transitions and the setpoints
+         * in a single frame per cycle. Set the values with setControlWord,
+         * setControlTargets and setControlOffsets, and send the frame
+         * returned by getRPDOMessage.
+         *
+         * The drive must be in the corresponding operation mode, see
+         * setOperationMode and configureInterpolationPeriod
+         *
+         * @param mode one of the OPERATION_MODE_CYCLIC_SYNCHRONOUS_ modes
+         * @param offsets a combination of CONTROL_PDO_OFFSETS flags
+         * @throw std::invalid_argument if the mode is not a cyclic
+         *   synchronous mode, or if the mapping does not fit in 8 bytes
+         */
+        std::vector<canbus::Message> configureCombinedControlPDO(
+            int pdoIndex, OPERATION_MODES mode, int offsets = 0,
+            canopen_master::PDOCommunicationParameters parameters =
+                canopen_master::PDOCommunicationParameters::Sync(1));
+
+        /** Returns the CAN messages that set the interpolation time period
+         * of the cyclic synchronous modes
+         *
+         * It should match the period at which the setpoints are sent
+         *
+         * @throw std::invalid_argument if the period cannot be represented
+         *   as N * 10^-k seconds with N < 256, with a resolution of at most a
+         *   microsecond
+         */
+        std::vector<canbus::Message> configureInterpolationPeriod(base::Time const& period);
+
+        /** Sets the control word in the object dictionary
+         *
+         * Like setControlTargets, it is not sent to the device, and is
+         * encoded directly in the RPDO configured with
+         * configureCombinedControlPDO if there is one
+         */
+        void setControlWord(ControlWord const& controlWord);
+
+        /** Sets the velocity and torque offsets in the object dictionary
+         *
+         * Unset values (NaN) are left unchanged. Like setControlTargets, it
+         * is not sent to the device, and is encoded directly in the RPDO
+         * frames that contain the offsets
+         */
+        void setControlOffsets(double velocityOffset, double torqueOffset);
+
+        /** Returns the frame of a RPDO
+         *
+         * For the RPDOs configured with configureControlPDO or
+         * configureCombinedControlPDO, this is a copy of the frame returned
+         * by getRPDOFrame. Otherwise, the frame is built from the object
+         * dictionary.
+         */
         canbus::Message getRPDOMessage(unsigned int pdoIndex);
 
-        /** Query the upload of an object */
+        /** Returns the preallocated frame of a RPDO configured with
+         * configureControlPDO or configureCombinedControlPDO
+         *
+         * The frame is updated in place by setControlTargets,
+         * setControlWord and setControlOffsets, so the reference can be
+         * kept and sent every cycle without building a new message.
+         *
+         * @throw std::invalid_argument if the RPDO has not been configured
+         *   by one of these methods
+         */
+        canbus::Message const& getRPDOFrame(unsigned int pdoIndex) const;
+
+        /** Query the upload of an object
+         *
+         * It is available for all the objects of CANOPEN_OBJECT_LIST
+         */
         template<typename T>
         canbus::Message queryObject() const;
 
         /** Get an object from the object database */
         template<typename T> T get() const;
 
+        /** Get the raw value of an object from the object database
+         *
+         * Unlike get(), it is available for all the objects of
+         * CANOPEN_OBJECT_LIST, as it does not need a parse function
+         */
+        template<typename T> typename T::OBJECT_TYPE getRaw() const;
+
         /** Check whether the given object has been initialized in the object database */
         template<typename T> bool has() const
         {
@@ -220,16 +613,212 @@ namespace motors_elmo_ds402 {
         }
 
     private:
+        uint8_t mNodeId;
         StateMachine mCanOpen;
         double mRatedTorque;
-        Factors mFactors;
+        /** Protects mFactors and mFactorsDirty, which are updated by the
+         * const getters when the factors are out of date
+         */
+        mutable std::mutex mFactorsLock;
+        mutable Factors mFactors;
+        mutable bool mFactorsDirty = false;
 
         int64_t mZeroPosition = 0;
 
+        /** Latest raw values of the objects read by the control loop
+         *
+         * They are updated in process(), so that the accessors read them
+         * without going through the object dictionary
+         */
+        struct alignas(64) HotObjects
+        {
+            /** The UPDATE_ID of the fields that have been received at least
+             * once
+             */
+            uint64_t updated = 0;
+            int32_t position = 0;
+            int32_t velocity = 0;
+            int16_t current = 0;
+            uint16_t statusWord = 0;
+            int8_t operationMode = 0;
+            uint32_t driveTimestamp = 0;
+        };
+        HotObjects mHotObjects;
+
+        /** Conversion of the drive timestamps received in TPDOs */
+        DriveClock mDriveClock;
+
+        /** Layout of a TPDO that contains only objects from HotObjects
+         *
+         * These TPDOs are decoded directly into mHotObjects in process(),
+         * without going through the object dictionary
+         */
+        struct HotTPDO
+        {
+            uint32_t canId = 0;
+            uint8_t size = 0;
+            /** The UPDATE_ID of the objects contained in the PDO */
+            uint64_t updates = 0;
+            /** The objects contained in the PDO */
+            ObjectSet objects;
+            int8_t positionOffset = -1;
+            int8_t velocityOffset = -1;
+            int8_t currentOffset = -1;
+            int8_t statusWordOffset = -1;
+            int8_t timestampOffset = -1;
+
+            void add(uint64_t updateId, uint8_t objectSize);
+
+            template<typename Object>
+            void add()
+            {
+                add(Object::UPDATE_ID, sizeof(typename Object::OBJECT_TYPE));
+                objects.add<Object>();
+            }
+        };
+
+        /** The TPDOs that are decoded directly, indexed by PDO index */
+        HotTPDO mHotTPDOs[4];
+
+        /** Register the layout of a TPDO to be decoded directly
+         *
+         * An empty layout disables direct decoding for this PDO
+         */
+        void declareHotTPDO(int pdoIndex, HotTPDO layout);
+        /** Decode a TPDO registered with declareHotTPDO */
+        Update processHotTPDO(HotTPDO const& layout, canbus::Message const& msg);
+
+        /** The objects that can be encoded directly in a HotRPDO */
+        enum HOT_RPDO_FIELDS
+        {
+            RPDO_CONTROL_WORD,
+            RPDO_TARGET_POSITION,
+            RPDO_TARGET_VELOCITY,
+            RPDO_TARGET_TORQUE,
+            RPDO_VELOCITY_OFFSET,
+            RPDO_TORQUE_OFFSET,
+            RPDO_FIELD_COUNT
+        };
+
+        /** A preallocated RPDO frame
+         *
+         * The setters of the control objects encode the values directly in
+         * the frame, so that getRPDOFrame() can return it as-is without
+         * going through the object dictionary
+         */
+        struct HotRPDO
+        {
+            canbus::Message frame;
+            /** The offset of each field in the frame, -1 if the field is
+             * not mapped
+             */
+            int8_t offsets[RPDO_FIELD_COUNT];
+
+            HotRPDO();
+            void add(HOT_RPDO_FIELDS field, uint8_t objectSize);
+        };
+
+        /** The RPDOs that are encoded directly, indexed by PDO index */
+        HotRPDO mHotRPDOs[4];
+        /** The fields, as 1 << HOT_RPDO_FIELDS, mapped in at least one of
+         * mHotRPDOs
+         */
+        uint32_t mHotRPDOFields = 0;
+
+        /** Register the layout of a RPDO to be encoded directly
+         *
+         * The frame is initialized with the values of the object dictionary
+         */
+        void declareHotRPDO(int pdoIndex, HotRPDO layout);
+        /** Initialize a field of a HotRPDO from the object dictionary */
+        template<typename T>
+        void initHotRPDOField(HotRPDO& layout, HOT_RPDO_FIELDS field) const;
+        /** Encode a control object in the RPDO frames that contain it, or
+         * in the object dictionary if there are none
+         */
+        template<typename T>
+        void setControlRaw(HOT_RPDO_FIELDS field, typename T::OBJECT_TYPE value);
+
+        /** Raw thresholds of isInDeadband */
+        struct RawDeadband
+        {
+            int64_t position = 0;
+            int64_t velocity = 0;
+            int64_t current = 0;
+        };
+        RawDeadband mDeadband;
+
+        /** Shared implementation of configureTPDOs, configureEventTPDOs and
+         * configureStatusPDO
+         *
+         * @param timing the event timing of the PDOs, or null for none
+         */
+        std::vector<canbus::Message> configureTPDOs(
+            int pdoIndex, int pdoCount, ObjectSet const& objects,
+            canopen_master::PDOCommunicationParameters parameters,
+            TPDOEventTiming const* timing);
+
+        /** Update the fields of mHotObjects that are marked in \c update */
+        void updateHotObjects(uint64_t update);
+
+        /** Returns a field of mHotObjects, falling back to the object
+         * dictionary if it has not been received yet
+         */
+        template<typename T>
+        typename T::OBJECT_TYPE getHotRaw(typename T::OBJECT_TYPE field) const;
+
+        /** Raw value of an object, as transferred by an expedited SDO */
+        struct DriveValue
+        {
+            uint32_t value;
+            uint8_t size;
+
+            bool operator ==(DriveValue const& other) const
+            {
+                return value == other.value && size == other.size;
+            }
+        };
+        /** Known drive values, indexed by full object ID */
+        std::map<uint32_t, DriveValue> mDriveValues;
+        /** Downloads returned by diffApply that have not been acked yet,
+         * in the order in which they are sent
+         */
+        std::deque<std::pair<uint32_t, DriveValue>> mPendingDriveValues;
+        /** Store a drive value in the object dictionary, if the object is
+         * known to this library
+         */
+        void setDictionaryValue(uint32_t fullId, uint32_t value);
+        /** Update the known drive values from a SDO message */
+        void processDriveValues(canbus::Message const& msg);
+        /** Find the pending download that a SDO answer for \c fullId
+         * answers, and drop the pending downloads before it, which never
+         * got an answer. The match is then at the front of
+         * mPendingDriveValues
+         *
+         * @return false if the answer does not match a pending download
+         */
+        bool matchPendingDriveValue(uint32_t fullId);
+
         MotorParameters mMotorParameters;
         Factors computeFactors() const;
+        /** Write the motor parameters in the object dictionary and mark the
+         * factors as out of date
+         */
+        void applyMotorParameters();
+        /** Returns the factors, recomputing them first if they are out of
+         * date
+         *
+         * It is safe to call concurrently from multiple threads
+         */
+        Factors getCurrentFactors() const;
+
+        /** Process a single message, without doing the post-processing
+         * that depends on what got updated
+         */
+        Update processMessage(canbus::Message const& msg);
+        /** Do the processing that depends on the content of an update */
+        void processUpdate(Update const& update);
 
-        template<typename T> typename T::OBJECT_TYPE getRaw() const;
         template<typename T> void setRaw(typename T::OBJECT_TYPE value);
     };
 }
@@ -0,0 +1,122 @@
+#include <motors_elmo_ds402/DriveClock.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+DriveClock::DriveClock(Parameters const& parameters)
+    : mParameters(parameters)
+{
+}
+
+void DriveClock::reset()
+{
+    *this = DriveClock(mParameters);
+}
+
+bool DriveClock::isValid() const
+{
+    return mValid;
+}
+
+double DriveClock::getDrift() const
+{
+    // mSlope is the host time elapsed per drive microsecond
+    return (1 / mSlope - 1) * 1e6;
+}
+
+int64_t DriveClock::unwrap(uint32_t driveTimestamp) const
+{
+    // The difference modulo 2^32, taken as signed, is the actual difference
+    // as long as the timestamps are less than 2^31 us apart
+    return mLastDrive + static_cast<int32_t>(driveTimestamp - mLastRaw);
+}
+
+void DriveClock::update(uint32_t driveTimestamp, base::Time const& hostTime)
+{
+    if (!mValid)
+    {
+        mValid = true;
+        mLastRaw = driveTimestamp;
+        mHostOrigin = hostTime.toMicroseconds();
+        mBucketMin = make_pair(0, 0);
+        return;
+    }
+
+    int64_t drive = unwrap(driveTimestamp);
+    int64_t host = hostTime.toMicroseconds() - mHostOrigin;
+    if (drive > mLastDrive)
+    {
+        mLastDrive = drive;
+        mLastRaw = driveTimestamp;
+    }
+
+    // Follow the lower envelope of the reception times: the latency is
+    // positive, so a sample that arrives earlier than predicted means that
+    // the offset is too high
+    double predicted = mHostReference + mSlope * (drive - mDriveReference);
+    double residual = host - predicted;
+    if (residual > 0)
+        residual *= mParameters.offsetGain;
+    mHostReference = predicted + residual;
+    mDriveReference = drive;
+
+    if (host - drive < mBucketMin.second - mBucketMin.first)
+        mBucketMin = make_pair(drive, host);
+    if (drive - mBucketStart >= mParameters.bucketPeriod.toMicroseconds())
+    {
+        mBuckets.push_back(mBucketMin);
+        while (static_cast<int>(mBuckets.size()) > mParameters.bucketCount)
+            mBuckets.pop_front();
+        mBucketStart = drive;
+        mBucketMin = make_pair(drive, host);
+        updateSlope();
+    }
+}
+
+void DriveClock::updateSlope()
+{
+    if (mBuckets.size() < 2)
+        return;
+
+    int64_t driveOrigin = mBuckets.front().first;
+    int64_t hostOrigin = mBuckets.front().second;
+    if (mBuckets.back().first - driveOrigin < mParameters.minDriftSpan.toMicroseconds())
+        return;
+
+    // Least-squares fit, relative to the first bucket to keep the values
+    // small
+    double meanX = 0, meanY = 0;
+    for (auto const& sample : mBuckets)
+    {
+        meanX += sample.first - driveOrigin;
+        meanY += sample.second - hostOrigin;
+    }
+    meanX /= mBuckets.size();
+    meanY /= mBuckets.size();
+
+    double sxx = 0, sxy = 0;
+    for (auto const& sample : mBuckets)
+    {
+        double x = sample.first - driveOrigin - meanX;
+        double y = sample.second - hostOrigin - meanY;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    if (sxx == 0)
+        return;
+
+    double maxDrift = mParameters.maxDrift * 1e-6;
+    mSlope = max(1 - maxDrift, min(1 + maxDrift, sxy / sxx));
+}
+
+base::Time DriveClock::toHostTime(uint32_t driveTimestamp) const
+{
+    if (!mValid)
+        return base::Time();
+
+    int64_t drive = unwrap(driveTimestamp);
+    double host = mHostReference + mSlope * (drive - mDriveReference);
+    return base::Time::fromMicroseconds(mHostOrigin + llround(host));
+}
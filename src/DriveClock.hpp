@@ -0,0 +1,114 @@
+#ifndef MOTORS_ELMO_DS402_DRIVE_CLOCK_HPP
+#define MOTORS_ELMO_DS402_DRIVE_CLOCK_HPP
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <base/Time.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Parameters of the DriveClock estimator */
+    struct DriveClockParameters
+    {
+        /** The drift is estimated from the sample with the lowest latency
+         * within each period of this length
+         */
+        base::Time bucketPeriod = base::Time::fromMilliseconds(100);
+        /** Number of periods used to estimate the drift */
+        int bucketCount = 100;
+        /** Minimum span of drive time before the drift is estimated. The
+         * drift is assumed to be zero until then.
+         */
+        base::Time minDriftSpan = base::Time::fromSeconds(1);
+        /** Maximum absolute drift, in parts per million */
+        double maxDrift = 1000;
+        /** Gain at which the offset follows samples that arrive later than
+         * predicted. Samples that arrive earlier than predicted are followed
+         * immediately, as the latency can only be positive.
+         */
+        double offsetGain = 0.01;
+    };
+
+    /** Online estimation of the relationship between a drive's
+     * microsecond clock (TimestampUsec) and the host clock
+     *
+     * It is fed with pairs of drive timestamps and host reception times,
+     * and estimates the host time at which the drive sampled the data. The
+     * offset tracks the lower envelope of the reception times, that is the
+     * samples with the least transmission latency, and the drift is
+     * estimated by a linear fit of this lower envelope. The 32-bit drive
+     * timestamp wrap-around (about 71 minutes) is handled.
+     *
+     * The minimum transmission latency cannot be observed, so the
+     * converted times are late by this amount. It is the same for all the
+     * drives of a bus, which keeps samples of different drives consistent.
+     */
+    class DriveClock
+    {
+    public:
+        typedef DriveClockParameters Parameters;
+
+        explicit DriveClock(Parameters const& parameters = Parameters());
+
+        /** Forget all samples */
+        void reset();
+
+        /** Add a drive timestamp and the host time at which it was received */
+        void update(uint32_t driveTimestamp, base::Time const& hostTime);
+
+        /** Whether at least one sample has been received */
+        bool isValid() const;
+
+        /** Convert a drive timestamp into host time
+         *
+         * The timestamp must be within 35 minutes of the last sample passed
+         * to update()
+         *
+         * @return a null time if no sample has been received yet
+         */
+        base::Time toHostTime(uint32_t driveTimestamp) const;
+
+        /** The estimated drift of the drive clock relative to the host
+         * clock, in parts per million
+         */
+        double getDrift() const;
+
+        /** Returns the drive timestamp, in microseconds since the first
+         * sample and without wrap-around
+         */
+        int64_t unwrap(uint32_t driveTimestamp) const;
+
+    private:
+        Parameters mParameters;
+
+        bool mValid = false;
+        uint32_t mLastRaw = 0;
+        int64_t mLastDrive = 0;
+
+        /** Host time of the first sample, in microseconds. The other host
+         * times are relative to it.
+         */
+        int64_t mHostOrigin = 0;
+
+        /** Reference point of the estimated line, host time as a function
+         * of the unwrapped drive time
+         */
+        int64_t mDriveReference = 0;
+        double mHostReference = 0;
+        /** Slope of the line, in host microseconds per drive microsecond */
+        double mSlope = 1;
+
+        /** The (drive, host) sample with the lowest latency in the current
+         * bucket
+         */
+        std::pair<int64_t, int64_t> mBucketMin;
+        int64_t mBucketStart = 0;
+        /** The lowest-latency samples of the previous buckets */
+        std::deque<std::pair<int64_t, int64_t>> mBuckets;
+
+        void updateSlope();
+    };
+}
+
+#endif
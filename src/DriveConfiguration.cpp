@@ -0,0 +1,445 @@
+#include <motors_elmo_ds402/DriveConfiguration.hpp>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+ConfigurationError::ConfigurationError(string const& source, int line,
+    string const& message)
+    : std::runtime_error(source + ":" + to_string(line) + ": " + message)
+{
+}
+
+static string trim(string const& str)
+{
+    size_t start = str.find_first_not_of(" \t\r");
+    if (start == string::npos)
+        return string();
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(start, end - start + 1);
+}
+
+namespace
+{
+    /** Helper to parse values while reporting errors with the line
+     * information
+     */
+    struct Parser
+    {
+        string source;
+        int line = 0;
+
+        void error(string const& message) const
+        {
+            throw ConfigurationError(source, line, message);
+        }
+
+        int64_t parseInteger(string const& value) const
+        {
+            size_t end = 0;
+            int64_t result = 0;
+            try {
+                result = stoll(value, &end, 0);
+            }
+            catch(std::exception const&) {
+                end = 0;
+            }
+            if (end == 0 || end != value.size())
+                error("expected an integer, got '" + value + "'");
+            return result;
+        }
+
+        double parseDouble(string const& value) const
+        {
+            size_t end = 0;
+            double result = 0;
+            try {
+                result = stod(value, &end);
+            }
+            catch(std::exception const&) {
+                end = 0;
+            }
+            if (end == 0 || end != value.size())
+                error("expected a number, got '" + value + "'");
+            return result;
+        }
+    };
+}
+
+DriveConfiguration DriveConfiguration::load(string const& path)
+{
+    ifstream file(path.c_str());
+    if (!file)
+        throw ConfigurationError(path, 0, "cannot open file");
+    return parse(file, path);
+}
+
+static void parseMotorEntry(Parser const& parser, MotorParameters& parameters,
+    string const& key, string const& value)
+{
+    if (key == "torque_constant")
+    {
+        parameters.torqueConstant = parser.parseDouble(value);
+        return;
+    }
+
+    int64_t integer = parser.parseInteger(value);
+    if (key == "encoder_ticks")
+        parameters.encoderTicks = integer;
+    else if (key == "encoder_revolutions")
+        parameters.encoderRevolutions = integer;
+    else if (key == "gear_motor_shaft_revolutions")
+        parameters.gearMotorShaftRevolutions = integer;
+    else if (key == "gear_driving_shaft_revolutions")
+        parameters.gearDrivingShaftRevolutions = integer;
+    else if (key == "feed_length")
+        parameters.feedLength = integer;
+    else if (key == "feed_driving_shaft_revolutions")
+        parameters.feedDrivingShaftRevolutions = integer;
+    else
+        parser.error("unknown motor parameter '" + key + "'");
+}
+
+template<typename T>
+static bool isInRange(int64_t value)
+{
+    return value >= numeric_limits<T>::min() && value <= numeric_limits<T>::max();
+}
+
+static bool isInRange(OBJECT_TYPES type, int64_t value)
+{
+    switch(type)
+    {
+        case OBJECT_TYPE_INT8: return isInRange<int8_t>(value);
+        case OBJECT_TYPE_UINT8: return isInRange<uint8_t>(value);
+        case OBJECT_TYPE_INT16: return isInRange<int16_t>(value);
+        case OBJECT_TYPE_UINT16: return isInRange<uint16_t>(value);
+        case OBJECT_TYPE_INT32: return isInRange<int32_t>(value);
+        case OBJECT_TYPE_UINT32: return isInRange<uint32_t>(value);
+    }
+    return false;
+}
+
+DriveConfiguration DriveConfiguration::parse(istream& stream, string const& source)
+{
+    DriveConfiguration config;
+    Parser parser;
+    parser.source = source;
+
+    map<int, int64_t> objects;
+    string section;
+    string line;
+    while (getline(stream, line))
+    {
+        ++parser.line;
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        if (line[0] == '[')
+        {
+            if (line.back() != ']')
+                parser.error("invalid section header");
+            section = trim(line.substr(1, line.size() - 2));
+
+            if (section == "motor")
+                config.mHasMotorParameters = true;
+            else if (section == "joint_state_tpdo")
+                config.mJointStateTPDO.enabled = true;
+            else if (section == "status_tpdo")
+                config.mStatusTPDO.enabled = true;
+            else if (section == "control_rpdo")
+                config.mControlRPDO.enabled = true;
+            else if (section != "objects")
+                parser.error("unknown section '" + section + "'");
+            continue;
+        }
+
+        size_t equal = line.find('=');
+        if (equal == string::npos)
+            parser.error("expected 'key = value'");
+        string key = trim(line.substr(0, equal));
+        string value = trim(line.substr(equal + 1));
+
+        if (section.empty())
+            parser.error("entry outside of a section");
+        else if (section == "motor")
+            parseMotorEntry(parser, config.mMotorParameters, key, value);
+        else if (section == "objects")
+        {
+            ObjectInfo const* info = findObject(key.c_str());
+            if (!info)
+                parser.error("unknown object '" + key + "'");
+            if (!info->isWritable())
+                parser.error("object '" + key + "' is read-only");
+            int64_t raw = parser.parseInteger(value);
+            if (!isInRange(info->type, raw))
+                parser.error("value out of range for '" + key + "' (" +
+                    getObjectTypeName(info->type) + ")");
+            objects[info - OBJECT_REGISTRY] = raw;
+        }
+        else
+        {
+            PDO& pdo =
+                (section == "joint_state_tpdo") ? config.mJointStateTPDO :
+                (section == "status_tpdo") ? config.mStatusTPDO : config.mControlRPDO;
+
+            if (key == "index")
+            {
+                pdo.index = parser.parseInteger(value);
+                if (pdo.index < 0 || pdo.index > 3)
+                    parser.error("PDO index must be between 0 and 3");
+            }
+            else if (key == "transmission")
+            {
+                istringstream words(value);
+                string mode;
+                words >> mode;
+                if (mode == "async")
+                    pdo.transmission.mode = Transmission::ASYNC;
+                else if (mode == "sync" || mode == "periodic")
+                {
+                    string period;
+                    words >> period;
+                    pdo.transmission.mode = (mode == "sync") ?
+                        Transmission::SYNC : Transmission::PERIODIC;
+                    pdo.transmission.period = parser.parseInteger(period);
+                    if (pdo.transmission.period <= 0)
+                        parser.error("the transmission period must be positive");
+                }
+                else if (mode == "event" && section != "control_rpdo")
+                {
+                    string inhibit, timer;
+                    words >> inhibit >> timer;
+                    double inhibitMs = parser.parseDouble(inhibit);
+                    int64_t timerMs = timer.empty() ? 0 : parser.parseInteger(timer);
+                    if (inhibitMs < 0 || inhibitMs > 6553.5)
+                        parser.error("the inhibit time must be between 0 and 6553.5ms");
+                    if (timerMs < 0 || timerMs > 65535)
+                        parser.error("the event timer must be between 0 and 65535ms");
+                    pdo.transmission.mode = Transmission::EVENT;
+                    pdo.transmission.timing.inhibitTime =
+                        base::Time::fromMicroseconds(inhibitMs * 1000);
+                    pdo.transmission.timing.eventTimer =
+                        base::Time::fromMilliseconds(timerMs);
+                }
+                else if (mode == "event")
+                    parser.error("event transmission is only available for TPDOs");
+                else
+                    parser.error("transmission must be 'sync N', 'async', 'periodic MS' or 'event INHIBIT_MS [TIMER_MS]'");
+            }
+            else if (key == "fields" && section == "joint_state_tpdo")
+            {
+                istringstream words(value);
+                string field;
+                uint64_t fields = 0;
+                while (words >> field)
+                {
+                    if (field == "position")
+                        fields |= UPDATE_JOINT_POSITION;
+                    else if (field == "velocity")
+                        fields |= UPDATE_JOINT_VELOCITY;
+                    else if (field == "current")
+                        fields |= UPDATE_JOINT_CURRENT;
+                    else if (field == "timestamp")
+                        fields |= UPDATE_DRIVE_TIMESTAMP;
+                    else
+                        parser.error("unknown joint state field '" + field + "'");
+                }
+                config.mJointStateFields = fields;
+            }
+            else if (key == "timestamp" && section == "status_tpdo")
+            {
+                if (value == "true")
+                    config.mStatusTimestamp = true;
+                else if (value == "false")
+                    config.mStatusTimestamp = false;
+                else
+                    parser.error("timestamp must be true or false");
+            }
+            else if (key == "mode" && section == "control_rpdo")
+            {
+                if (value == "position")
+                    config.mControlMode = base::JointState::POSITION;
+                else if (value == "speed")
+                    config.mControlMode = base::JointState::SPEED;
+                else if (value == "effort")
+                    config.mControlMode = base::JointState::EFFORT;
+                else
+                    parser.error("control mode must be position, speed or effort");
+            }
+            else
+                parser.error("unknown key '" + key + "' in section " + section);
+        }
+    }
+
+    // configureJointStateUpdatePDOs always configures (or disables) two
+    // consecutive PDOs
+    int jointStateIndex = config.mJointStateTPDO.index;
+    if (config.mJointStateTPDO.enabled && jointStateIndex > 2)
+        throw ConfigurationError(source, parser.line,
+            "the joint state TPDO index must be between 0 and 2");
+    if (config.mJointStateTPDO.enabled && config.mStatusTPDO.enabled &&
+        config.mStatusTPDO.index >= jointStateIndex &&
+        config.mStatusTPDO.index <= jointStateIndex + 1)
+        throw ConfigurationError(source, parser.line,
+            "the status TPDO overlaps with the joint state TPDOs");
+
+    // The timestamp changes at every sample, which would defeat event-driven
+    // transmission
+    if ((config.mJointStateTPDO.enabled &&
+         config.mJointStateTPDO.transmission.mode == Transmission::EVENT &&
+         (config.mJointStateFields & UPDATE_DRIVE_TIMESTAMP)) ||
+        (config.mStatusTPDO.enabled &&
+         config.mStatusTPDO.transmission.mode == Transmission::EVENT &&
+         config.mStatusTimestamp))
+        throw ConfigurationError(source, parser.line,
+            "the drive timestamp cannot be sent through an event-driven TPDO");
+
+    config.mObjects.assign(objects.begin(), objects.end());
+    return config;
+}
+
+bool DriveConfiguration::hasMotorParameters() const
+{
+    return mHasMotorParameters;
+}
+
+MotorParameters const& DriveConfiguration::getMotorParameters() const
+{
+    return mMotorParameters;
+}
+
+canopen_master::PDOCommunicationParameters DriveConfiguration::Transmission::get() const
+{
+    switch(mode)
+    {
+        case SYNC:
+            return canopen_master::PDOCommunicationParameters::Sync(period);
+        case PERIODIC:
+            return canopen_master::PDOCommunicationParameters::Periodic(
+                base::Time::fromMilliseconds(period));
+        default:
+            return canopen_master::PDOCommunicationParameters::Async();
+    }
+}
+
+vector<canbus::Message> DriveConfiguration::apply(Controller& controller, bool diff) const
+{
+    if (mHasMotorParameters)
+        controller.setMotorParameters(mMotorParameters);
+
+    vector<canbus::Message> messages;
+    for (auto const& object : mObjects)
+        messages.push_back(controller.sendRaw(OBJECT_REGISTRY[object.first], object.second));
+
+    if (mJointStateTPDO.enabled)
+    {
+        Transmission const& transmission = mJointStateTPDO.transmission;
+        auto pdo = (transmission.mode == Transmission::EVENT) ?
+            controller.configureJointStateEventPDOs(mJointStateTPDO.index,
+                transmission.timing, mJointStateFields) :
+            controller.configureJointStateUpdatePDOs(mJointStateTPDO.index,
+                transmission.get(), mJointStateFields);
+        messages.insert(messages.end(), pdo.begin(), pdo.end());
+    }
+    if (mStatusTPDO.enabled)
+    {
+        Transmission const& transmission = mStatusTPDO.transmission;
+        vector<canbus::Message> pdo;
+        if (transmission.mode == Transmission::EVENT)
+        {
+            ObjectSet objects;
+            objects.add<StatusWordRegister>();
+            pdo = controller.configureEventTPDOs(mStatusTPDO.index, 1,
+                objects, transmission.timing);
+        }
+        else
+            pdo = controller.configureStatusPDO(mStatusTPDO.index,
+                transmission.get(), mStatusTimestamp);
+        messages.insert(messages.end(), pdo.begin(), pdo.end());
+    }
+    if (mControlRPDO.enabled)
+    {
+        auto pdo = controller.configureControlPDO(mControlRPDO.index,
+            mControlMode, mControlRPDO.transmission.get());
+        messages.insert(messages.end(), pdo.begin(), pdo.end());
+    }
+
+    if (diff)
+        return controller.diffApply(messages);
+    else
+        return messages;
+}
+
+static const char FRAMES_MAGIC[4] = { 'E', 'D', 'S', 'F' };
+static const int FRAME_SIZE = 13;
+
+void DriveConfiguration::saveFrames(string const& path,
+    vector<canbus::Message> const& frames)
+{
+    ofstream file(path.c_str(), ios::binary);
+    file.write(FRAMES_MAGIC, 4);
+
+    uint8_t buffer[FRAME_SIZE];
+    uint32_t count = frames.size();
+    for (int i = 0; i < 4; ++i)
+        buffer[i] = (count >> (8 * i)) & 0xFF;
+    file.write(reinterpret_cast<char const*>(buffer), 4);
+
+    for (auto const& frame : frames)
+    {
+        for (int i = 0; i < 4; ++i)
+            buffer[i] = (frame.can_id >> (8 * i)) & 0xFF;
+        buffer[4] = frame.size;
+        copy(frame.data, frame.data + 8, buffer + 5);
+        file.write(reinterpret_cast<char const*>(buffer), FRAME_SIZE);
+    }
+    if (!file)
+        throw std::runtime_error("failed to write frames to " + path);
+}
+
+vector<canbus::Message> DriveConfiguration::loadFrames(string const& path)
+{
+    ifstream file(path.c_str(), ios::binary);
+    char magic[4];
+    uint8_t buffer[FRAME_SIZE];
+    if (!file.read(magic, 4) || !equal(magic, magic + 4, FRAMES_MAGIC) ||
+        !file.read(reinterpret_cast<char*>(buffer), 4))
+        throw std::runtime_error(path + " is not a frame file");
+
+    uint32_t count = 0;
+    for (int i = 0; i < 4; ++i)
+        count |= static_cast<uint32_t>(buffer[i]) << (8 * i);
+
+    // Validate the count against the file size before allocating anything
+    streampos start = file.tellg();
+    file.seekg(0, ios::end);
+    streamoff remaining = file.tellg() - start;
+    file.seekg(start);
+    if (!file || remaining != static_cast<streamoff>(count) * FRAME_SIZE)
+        throw std::runtime_error(path + " is truncated or corrupted");
+
+    vector<canbus::Message> frames;
+    frames.reserve(count);
+    for (uint32_t frameIndex = 0; frameIndex < count; ++frameIndex)
+    {
+        if (!file.read(reinterpret_cast<char*>(buffer), FRAME_SIZE))
+            throw std::runtime_error(path + " is truncated");
+
+        canbus::Message frame;
+        frame.can_id = 0;
+        for (int i = 0; i < 4; ++i)
+            frame.can_id |= static_cast<uint32_t>(buffer[i]) << (8 * i);
+        frame.size = buffer[4];
+        if (frame.size > 8)
+            throw std::runtime_error(path + " contains an invalid frame");
+        copy(buffer + 5, buffer + FRAME_SIZE, frame.data);
+        frames.push_back(frame);
+    }
+    return frames;
+}
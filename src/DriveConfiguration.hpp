@@ -0,0 +1,172 @@
+#ifndef MOTORS_ELMO_DS402_DRIVE_CONFIGURATION_HPP
+#define MOTORS_ELMO_DS402_DRIVE_CONFIGURATION_HPP
+
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <motors_elmo_ds402/Controller.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Exception thrown when a configuration file is invalid */
+    struct ConfigurationError : public std::runtime_error
+    {
+        ConfigurationError(std::string const& source, int line,
+            std::string const& message);
+    };
+
+    /** Declarative configuration of a drive
+     *
+     * The configuration is a text file made of sections, with one
+     * "key = value" entry per line. Lines starting with # are comments.
+     *
+     * <code>
+     * [motor]
+     * encoder_ticks = 4096
+     * torque_constant = 0.12
+     *
+     * [objects]
+     * MaxCurrent = 5000
+     * QuickStopOptionCode = 2
+     *
+     * [joint_state_tpdo]
+     * index = 0
+     * transmission = sync 1
+     * fields = position velocity current
+     *
+     * [status_tpdo]
+     * index = 2
+     * transmission = event 1 100
+     * timestamp = true
+     *
+     * [control_rpdo]
+     * index = 0
+     * mode = effort
+     * transmission = periodic 10
+     * </code>
+     *
+     * - [motor] sets the fields of MotorParameters, with the field names
+     *   in snake case
+     * - [objects] writes objects of the registry, given by name (see
+     *   motors_elmo_ds402_ctl list-objects). The values are validated
+     *   against the object's access and type.
+     * - [joint_state_tpdo], [status_tpdo] and [control_rpdo] configure the
+     *   PDOs of configureJointStateUpdatePDOs, configureStatusPDO and
+     *   configureControlPDO. The transmission is either "sync N", "async"
+     *   or "periodic MS". The TPDOs also accept "event INHIBIT_MS
+     *   [TIMER_MS]", which configures them with
+     *   Controller::configureEventTPDOs. Note that the joint state uses two
+     *   consecutive TPDOs, starting at the given index. The drive
+     *   timestamp (see Controller::getSampleTime) is sent with the joint
+     *   state by adding "timestamp" to its fields, or with the status word
+     *   with "timestamp = true".
+     *
+     * All sections are optional. The configuration is validated when it is
+     * loaded, so that apply() only fails on programming errors.
+     */
+    class DriveConfiguration
+    {
+    public:
+        /** Load and validate a configuration file
+         *
+         * @throw ConfigurationError
+         */
+        static DriveConfiguration load(std::string const& path);
+
+        /** Parse and validate a configuration
+         *
+         * @param source the name used in error messages
+         * @throw ConfigurationError
+         */
+        static DriveConfiguration parse(std::istream& stream,
+            std::string const& source = "<stream>");
+
+        /** Whether the configuration has a [motor] section */
+        bool hasMotorParameters() const;
+
+        MotorParameters const& getMotorParameters() const;
+
+        /** Apply the configuration to the controller, and return the SDO
+         * sequence that applies it to the drive
+         *
+         * It sets the motor parameters and declares the PDO mappings on
+         * the controller. The sequence contains the object writes, sorted
+         * by object ID and with one write per object, followed by the PDO
+         * configurations. It must be sent while the node is in
+         * pre-operational state.
+         *
+         * @param diff if true, the sequence is filtered with
+         *   Controller::diffApply, so that values already on the drive are
+         *   not written again. Only the drive values known to the
+         *   controller are used: send the queries of
+         *   Controller::queryDriveValues first, and pass false to get the
+         *   sequence these queries are computed from. Pass false as well to
+         *   get a sequence that can be saved with saveFrames
+         */
+        std::vector<canbus::Message> apply(Controller& controller, bool diff = true) const;
+
+        /** Save a frame sequence to a binary file that can be replayed
+         * without going through the configuration
+         *
+         * To save a configuration, use the unfiltered sequence returned by
+         * apply(controller, false). The filtered sequence depends on the
+         * values that were on the drive when it was generated, and would
+         * not fully configure another drive.
+         *
+         * The file only contains what is sent to the drive. Replaying it
+         * does not declare the PDO mappings on the controller, so apply()
+         * must still be called on the controller that processes the drive's
+         * PDOs, and its result discarded.
+         *
+         * @throw std::runtime_error if the file cannot be written
+         */
+        static void saveFrames(std::string const& path,
+            std::vector<canbus::Message> const& frames);
+
+        /** Load a frame sequence saved with saveFrames
+         *
+         * See saveFrames for what replaying it does not do
+         *
+         * @throw std::runtime_error if the file cannot be read or is invalid
+         */
+        static std::vector<canbus::Message> loadFrames(std::string const& path);
+
+    private:
+        /** Transmission parameters of a PDO */
+        struct Transmission
+        {
+            enum MODES { SYNC, ASYNC, PERIODIC, EVENT };
+
+            MODES mode = ASYNC;
+            /** Sync period or period in milliseconds */
+            int period = 0;
+            /** Inhibit time and event timer in EVENT mode */
+            TPDOEventTiming timing;
+
+            canopen_master::PDOCommunicationParameters get() const;
+        };
+
+        struct PDO
+        {
+            bool enabled = false;
+            int index = 0;
+            Transmission transmission;
+        };
+
+        bool mHasMotorParameters = false;
+        MotorParameters mMotorParameters;
+
+        /** Object writes, as (registry index, value), sorted by index */
+        std::vector<std::pair<int, int64_t>> mObjects;
+
+        PDO mJointStateTPDO;
+        uint64_t mJointStateFields = UPDATE_JOINT_STATE;
+        PDO mStatusTPDO;
+        bool mStatusTimestamp = false;
+        PDO mControlRPDO;
+        base::JointState::MODE mControlMode = base::JointState::EFFORT;
+    };
+}
+
+#endif
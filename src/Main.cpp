@@ -2,9 +2,15 @@
 #include <canbus.hh>
 #include <memory>
 #include <motors_elmo_ds402/Controller.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <motors_elmo_ds402/SDOTransactionQueue.hpp>
+#include <motors_elmo_ds402/BringUp.hpp>
+#include <motors_elmo_ds402/DriveConfiguration.hpp>
 #include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
 #include <string>
 #include <iomanip>
+#include <sstream>
 #include <signal.h>
 #include <cstring>
 
@@ -24,7 +30,9 @@ int usage()
     cout << "  set-torque # sets a torque command\n";
     cout << "  save # save the current configuration\n";
     cout << "  load # resets configuration using the one in the drive\n";
+    cout << "  apply-config CONFIG_FILE # applies a drive configuration file\n";
     cout << "  monitor-joint-state # periodically displays the joint state\n";
+    cout << "  list-objects # lists the objects known to this library\n";
     cout << endl;
     return 1;
 }
@@ -35,17 +43,12 @@ struct STRINGS {
     T value;
 };
 
+#define STATE_STRING(name) { #name, StatusWord::name },
 STRINGS<StatusWord::State> StateStrings[] = {
-    { "NOT_READY_TO_SWITCH_ON", StatusWord::NOT_READY_TO_SWITCH_ON },
-    { "SWITCH_ON_DISABLED", StatusWord::SWITCH_ON_DISABLED },
-    { "READY_TO_SWITCH_ON", StatusWord::READY_TO_SWITCH_ON },
-    { "SWITCH_ON", StatusWord::SWITCH_ON },
-    { "OPERATION_ENABLED", StatusWord::OPERATION_ENABLED },
-    { "QUICK_STOP_ACTIVE", StatusWord::QUICK_STOP_ACTIVE },
-    { "FAULT_REACTION_ACTIVE", StatusWord::FAULT_REACTION_ACTIVE },
-    { "FAULT", StatusWord::FAULT },
+    STATUS_WORD_STATE_LIST(STATE_STRING)
     { "", StatusWord::FAULT }
 };
+#undef STATE_STRING
 
 STRINGS<ControlWord::Transition> TransitionStrings[] = {
     { "SHUTDOWN", ControlWord::SHUTDOWN },
@@ -115,6 +118,26 @@ static void displayCANMessage(canbus::Message const& msg)
         std::cout << " " << std::hex << (int)msg.data[i];
 }
 
+static ObjectID getSDOObject(canbus::Message const& query)
+{
+    return ObjectID {
+        static_cast<uint16_t>(query.data[1] | query.data[2] << 8),
+        query.data[3] };
+}
+
+/** Process a message, and throw if it is an abort of the given SDO transfer
+ */
+static Update processSDOAnswer(canbus::Message const& msg,
+    motors_elmo_ds402::Controller& controller, ObjectID const& object)
+{
+    Update update = controller.process(msg);
+    for (int i = 0; i < update.getAbortCount(); ++i) {
+        if (update.getAbort(i).object == object)
+            throw SDOAbortError(update.getAbort(i));
+    }
+    return update;
+}
+
 static void writeObject(canbus::Driver& device, canbus::Message const& query,
     motors_elmo_ds402::Controller& controller,
     base::Time timeout = base::Time::fromMilliseconds(100))
@@ -125,23 +148,105 @@ static void writeObject(canbus::Driver& device, canbus::Message const& query,
     displayCANMessage(query);
     std::cout << std::endl;
 
+    ObjectID object = getSDOObject(query);
+    base::Time deadline = base::Time::now() + timeout;
     device.setReadTimeout(timeout.toMilliseconds());
     while(true)
     {
         canbus::Message msg = device.read();
-        if (controller.process(msg).isAck()) {
+        if (processSDOAnswer(msg, controller, object).isAcked(object.id, object.subId)) {
             return;
         }
+        else if (base::Time::now() > deadline) {
+            throw SDOTimeout(object);
+        }
     }
 }
 
+static void runTransactions(canbus::Driver& device, SDOTransactionQueue& queue,
+    motors_elmo_ds402::Controller& controller,
+    base::Time timeout)
+{
+    device.setReadTimeout(timeout.toMilliseconds());
+    while (true)
+    {
+        canbus::Message query;
+        while (queue.next(base::Time::now(), query)) {
+            device.write(query);
+            std::cout << "SDO Write: ";
+            displayCANMessage(query);
+            std::cout << std::endl;
+        }
+        if (queue.isDone())
+            break;
+
+        canbus::Message msg = device.read();
+        queue.process(controller.process(msg));
+    }
+
+    queue.checkFailures();
+}
+
+static void runBringUp(canbus::Driver& device, BringUp& bringUp,
+    base::Time pollPeriod)
+{
+    // Wake up at least once per poll period, so that the status word
+    // polls go out on time even if the bus is otherwise silent
+    device.setReadTimeout(pollPeriod.toMilliseconds());
+    vector<canbus::Message> messages;
+    while (true)
+    {
+        messages.clear();
+        bringUp.next(base::Time::now(), messages);
+        for (auto const& query : messages) {
+            device.write(query);
+            std::cout << "Bring-up Write: ";
+            displayCANMessage(query);
+            std::cout << std::endl;
+        }
+        if (bringUp.isDone())
+            break;
+
+        canbus::Message msg;
+        try {
+            msg = device.read();
+        }
+        catch(iodrivers_base::TimeoutError const&) {
+            continue;
+        }
+        bringUp.process(msg);
+    }
+
+    if (!bringUp.hasFailed())
+        return;
+
+    // Report the failures of all the drives at once
+    std::ostringstream message;
+    message << "the bring-up failed";
+    for (size_t i = 0; i < bringUp.size(); ++i)
+    {
+        if (bringUp.getStep(i) != BringUp::STEP_FAILED)
+            continue;
+
+        string failures = bringUp.getQueue(i).describeFailures();
+        message << "\n  drive " << i << ": ";
+        if (failures.empty())
+            message << "did not reach the OPERATION_ENABLED state";
+        else
+            message << failures;
+    }
+    throw std::runtime_error(message.str());
+}
+
 static void writeObjects(canbus::Driver& device, vector<canbus::Message> const& query,
     motors_elmo_ds402::Controller& controller,
     base::Time timeout = base::Time::fromMilliseconds(100))
 {
-    for(auto const& msg : query) {
-        writeObject(device, msg, controller, timeout);
-    }
+    SDOTransactionQueue::Policy policy;
+    policy.timeout = timeout;
+    SDOTransactionQueue queue(controller.getNodeId(), policy);
+    queue.push(query);
+    runTransactions(device, queue, controller, timeout);
 }
 
 template<typename Object>
@@ -149,16 +254,22 @@ static Object querySingleObject(canbus::Driver& device,
     motors_elmo_ds402::Controller& controller,
     base::Time timeout = base::Time::fromMilliseconds(1000))
 {
-    device.write(controller.queryObject<Object>());
+    canbus::Message query = controller.queryObject<Object>();
+    device.write(query);
     device.setReadTimeout(timeout.toMilliseconds());
+    ObjectID object = getSDOObject(query);
+    base::Time deadline = base::Time::now() + timeout;
     base::Time current = controller.timestamp<Object>();
     while(true)
     {
         canbus::Message msg = device.read();
-        controller.process(msg);
+        processSDOAnswer(msg, controller, object);
         if (current != controller.timestamp<Object>()) {
             return controller.get<Object>();
         }
+        else if (base::Time::now() > deadline) {
+            throw SDOTimeout(object);
+        }
     }
 }
 
@@ -169,12 +280,17 @@ static void queryObject(canbus::Driver& device, canbus::Message const& query,
 {
     device.write(query);
     device.setReadTimeout(timeout.toMilliseconds());
+    ObjectID object = getSDOObject(query);
+    base::Time deadline = base::Time::now() + timeout;
     while(true)
     {
         canbus::Message msg = device.read();
-        if (controller.process(msg).hasOneUpdated(updateId)) {
+        if (processSDOAnswer(msg, controller, object).hasOneUpdated(updateId)) {
             return;
         }
+        else if (base::Time::now() > deadline) {
+            throw SDOTimeout(object);
+        }
     }
 }
 
@@ -231,6 +347,21 @@ int main(int argc, char** argv)
     int8_t node_id(stoi(argv[3]));
     std::string cmd(argv[4]);
 
+    if (cmd == "list-objects")
+    {
+        if (argc != 5)
+            return usage();
+
+        for (ObjectInfo const& info : OBJECT_REGISTRY) {
+            cout << hex << setfill('0') << setw(4) << info.id << "."
+                << setw(2) << static_cast<int>(info.subId) << setfill(' ') << " "
+                << (info.isWritable() ? "rw" : "ro") << " "
+                << setw(6) << left << getObjectTypeName(info.type) << right << " "
+                << info.name << "\n";
+        }
+        return 0;
+    }
+
     unique_ptr<canbus::Driver> device;
     try {
         device.reset(canbus::openCanDevice(can_device, can_device_type));
@@ -360,35 +491,24 @@ int main(int argc, char** argv)
 
         Deinit deinit(*device, controller);
 
-        device->write(controller.queryNodeStateTransition(
-            canopen_master::NODE_ENTER_PRE_OPERATIONAL));
-        writeObjects(*device,
-            controller.configureJointStateUpdatePDOs(0, PDOCommunicationParameters::Sync(1)),
-            controller);
-        writeObjects(*device,
-            controller.configureStatusPDO(2, PDOCommunicationParameters::Sync(1)),
-            controller);
-        writeObjects(*device, controller.configureControlPDO(0, base::JointState::EFFORT),
-            controller);
-        device->write(controller.queryNodeStateTransition(
-            canopen_master::NODE_START));
+        vector<canbus::Message> configuration =
+            controller.configureJointStateUpdatePDOs(0, PDOCommunicationParameters::Sync(1));
+        auto statusPDO =
+            controller.configureStatusPDO(2, PDOCommunicationParameters::Sync(1));
+        auto controlPDO =
+            controller.configureControlPDO(0, base::JointState::EFFORT);
+        configuration.insert(configuration.end(), statusPDO.begin(), statusPDO.end());
+        configuration.insert(configuration.end(), controlPDO.begin(), controlPDO.end());
+
+        // The status PDO is synchronous and we do not send syncs during the
+        // bring-up, so BringUp polls the status word through SDO
+        BringUp::Timing timing;
+        timing.statusPollPeriod = base::Time::fromMilliseconds(10);
+        BringUp bringUp(SDOTransactionQueue::Policy(), timing);
+        bringUp.add(controller, configuration, OPERATION_MODE_PROFILED_TORQUE);
+        runBringUp(*device, bringUp, timing.statusPollPeriod);
 
         double target_torque = atof(argv[5]);
-        writeObject(*device,
-            controller.send(ControlWord(ControlWord::SHUTDOWN, true)),
-            controller);
-        writeObject(*device,
-            controller.setOperationMode(OPERATION_MODE_PROFILED_TORQUE),
-            controller);
-        usleep(1000);
-        writeObject(*device,
-            controller.send(ControlWord(ControlWord::SWITCH_ON, true)),
-            controller);
-        usleep(1000);
-        writeObject(*device,
-            controller.send(ControlWord(ControlWord::ENABLE_OPERATION, false)),
-            controller);
-        usleep(1000);
         controller.setEncoderScaleFactor(1);
 
         canbus::Message sync = controller.querySync();
@@ -403,7 +523,7 @@ int main(int argc, char** argv)
             }
             usleep(2000);
             controller.setControlTargets(base::JointState::Effort(target_torque));
-            device->write(controller.getRPDOMessage(0));
+            device->write(controller.getRPDOFrame(0));
             device->write(sync);
             std::cout << dec << base::Time::now().toMilliseconds() << " ";
 
@@ -448,6 +568,22 @@ int main(int argc, char** argv)
             return usage();
         writeObject(*device, controller.queryLoad(), controller);
     }
+    else if (cmd == "apply-config")
+    {
+        if (argc != 6)
+            return usage();
+
+        DriveConfiguration config = DriveConfiguration::load(argv[5]);
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_ENTER_PRE_OPERATIONAL));
+        // diffApply only skips the writes whose drive value is known, so
+        // read the drive values first
+        auto messages = config.apply(controller, false);
+        writeObjects(*device, controller.queryDriveValues(messages), controller);
+        writeObjects(*device, controller.diffApply(messages), controller);
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_START));
+    }
     else if (cmd == "monitor-joint-state")
     {
         queryObjects(*device, controller.queryFactors(),
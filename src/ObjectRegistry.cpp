@@ -0,0 +1,84 @@
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <cstring>
+
+using namespace motors_elmo_ds402;
+
+namespace {
+    constexpr bool isRegistrySorted(size_t i)
+    {
+        return (i + 1 >= OBJECT_REGISTRY_SIZE) ||
+            (OBJECT_REGISTRY[i].fullId() < OBJECT_REGISTRY[i + 1].fullId() &&
+             isRegistrySorted(i + 1));
+    }
+    static_assert(isRegistrySorted(0),
+        "CANOPEN_OBJECT_LIST must be sorted by object ID and sub ID, without duplicates");
+}
+
+namespace motors_elmo_ds402
+{
+    int findObjectIndex(uint32_t fullId)
+    {
+        // Binary search with a fixed iteration count, the comparison compiles
+        // into a conditional move. This is called for every object in every
+        // processed frame
+        size_t base = 0;
+        size_t size = OBJECT_REGISTRY_SIZE;
+        while (size > 1)
+        {
+            size_t half = size / 2;
+            base = (OBJECT_REGISTRY[base + half].fullId() <= fullId) ? base + half : base;
+            size -= half;
+        }
+        return (OBJECT_REGISTRY[base].fullId() == fullId) ? static_cast<int>(base) : -1;
+    }
+
+    ObjectInfo const* findObject(uint16_t objectId, uint8_t objectSubId)
+    {
+        int index = findObjectIndex(static_cast<uint32_t>(objectId) << 8 | objectSubId);
+        if (index == -1)
+            return nullptr;
+        else
+            return &OBJECT_REGISTRY[index];
+    }
+
+    ObjectInfo const* findObject(char const* name)
+    {
+        for (ObjectInfo const& info : OBJECT_REGISTRY)
+        {
+            if (std::strcmp(info.name, name) == 0)
+                return &info;
+        }
+        return nullptr;
+    }
+
+    char const* getObjectTypeName(OBJECT_TYPES type)
+    {
+        switch(type)
+        {
+            case OBJECT_TYPE_INT8: return "int8";
+            case OBJECT_TYPE_UINT8: return "uint8";
+            case OBJECT_TYPE_INT16: return "int16";
+            case OBJECT_TYPE_UINT16: return "uint16";
+            case OBJECT_TYPE_INT32: return "int32";
+            case OBJECT_TYPE_UINT32: return "uint32";
+        }
+        return "unknown";
+    }
+
+    size_t getObjectTypeSize(OBJECT_TYPES type)
+    {
+        switch(type)
+        {
+            case OBJECT_TYPE_INT8:
+            case OBJECT_TYPE_UINT8:
+                return 1;
+            case OBJECT_TYPE_INT16:
+            case OBJECT_TYPE_UINT16:
+                return 2;
+            case OBJECT_TYPE_INT32:
+            case OBJECT_TYPE_UINT32:
+                return 4;
+        }
+        return 0;
+    }
+}
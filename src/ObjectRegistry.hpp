@@ -0,0 +1,220 @@
+#ifndef MOTORS_ELMO_DS402_OBJECT_REGISTRY_HPP
+#define MOTORS_ELMO_DS402_OBJECT_REGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <motors_elmo_ds402/Objects.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Identification of an object in the dictionary */
+    struct ObjectID
+    {
+        uint16_t id;
+        uint8_t subId;
+
+        bool operator ==(ObjectID const& other) const
+        {
+            return id == other.id && subId == other.subId;
+        }
+    };
+
+    /** Raw types of the objects in the dictionary */
+    enum OBJECT_TYPES
+    {
+        OBJECT_TYPE_INT8,
+        OBJECT_TYPE_UINT8,
+        OBJECT_TYPE_INT16,
+        OBJECT_TYPE_UINT16,
+        OBJECT_TYPE_INT32,
+        OBJECT_TYPE_UINT32
+    };
+
+    /** Access rights of the objects in the dictionary */
+    enum OBJECT_ACCESS
+    {
+        OBJECT_ACCESS_RO,
+        OBJECT_ACCESS_WO,
+        OBJECT_ACCESS_RW
+    };
+
+    /** Mapping from a raw C++ type to the corresponding OBJECT_TYPES value */
+    template<typename T> struct ObjectTypeOf;
+    template<> struct ObjectTypeOf<std::int8_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_INT8; };
+    template<> struct ObjectTypeOf<std::uint8_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_UINT8; };
+    template<> struct ObjectTypeOf<std::int16_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_INT16; };
+    template<> struct ObjectTypeOf<std::uint16_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_UINT16; };
+    template<> struct ObjectTypeOf<std::int32_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_INT32; };
+    template<> struct ObjectTypeOf<std::uint32_t>
+    { static const OBJECT_TYPES value = OBJECT_TYPE_UINT32; };
+
+    /** Description of an object of the dictionary */
+    struct ObjectInfo
+    {
+        uint16_t id;
+        uint8_t subId;
+        char const* name;
+        OBJECT_TYPES type;
+        OBJECT_ACCESS access;
+        uint64_t updateId;
+
+        /** The object's full ID, i.e. (id << 8 | subId) */
+        constexpr uint32_t fullId() const
+        {
+            return static_cast<uint32_t>(id) << 8 | subId;
+        }
+
+        constexpr bool isReadable() const
+        {
+            return access != OBJECT_ACCESS_WO;
+        }
+
+        constexpr bool isWritable() const
+        {
+            return access != OBJECT_ACCESS_RO;
+        }
+    };
+
+    #define CANOPEN_OBJECT_INFO(object_id, object_sub_id, name, type, update_id, access) \
+        { object_id, object_sub_id, #name, ObjectTypeOf<type>::value, access, update_id },
+    #define CANOPEN_RO_OBJECT_INFO(object_id, object_sub_id, name, type, update_id) \
+        CANOPEN_OBJECT_INFO(object_id, object_sub_id, name, type, update_id, OBJECT_ACCESS_RO)
+    #define CANOPEN_RW_OBJECT_INFO(object_id, object_sub_id, name, type, update_id) \
+        CANOPEN_OBJECT_INFO(object_id, object_sub_id, name, type, update_id, OBJECT_ACCESS_RW)
+
+    /** Description of all the objects of CANOPEN_OBJECT_LIST, in the same
+     * order (i.e. sorted by full ID)
+     */
+    constexpr ObjectInfo OBJECT_REGISTRY[] = {
+        CANOPEN_OBJECT_LIST(CANOPEN_RO_OBJECT_INFO, CANOPEN_RW_OBJECT_INFO)
+    };
+
+    /** Number of elements in OBJECT_REGISTRY */
+    constexpr size_t OBJECT_REGISTRY_SIZE =
+        sizeof(OBJECT_REGISTRY) / sizeof(OBJECT_REGISTRY[0]);
+
+    /** Returns the index of an object in OBJECT_REGISTRY
+     *
+     * @return the index, or -1 if the object is not in the registry
+     */
+    int findObjectIndex(uint32_t fullId);
+
+    /** Compile-time version of findObjectIndex
+     *
+     * Use ObjectIndex instead
+     */
+    constexpr int lookupObjectIndex(uint32_t fullId, size_t start = 0)
+    {
+        return (start == OBJECT_REGISTRY_SIZE) ? -1 :
+            (OBJECT_REGISTRY[start].fullId() == fullId) ? static_cast<int>(start) :
+            lookupObjectIndex(fullId, start + 1);
+    }
+
+    /** Index of an object type in OBJECT_REGISTRY */
+    template<typename T>
+    struct ObjectIndex
+    {
+        static const int value = lookupObjectIndex(
+            static_cast<uint32_t>(T::OBJECT_ID) << 8 | T::OBJECT_SUB_ID);
+        static_assert(value != -1, "object is not part of CANOPEN_OBJECT_LIST");
+    };
+
+    /** A set of objects from OBJECT_REGISTRY
+     *
+     * It is a bitset indexed by the objects' index in the registry
+     */
+    struct ObjectSet
+    {
+        static const int CAPACITY = 128;
+        uint64_t words[CAPACITY / 64];
+
+        ObjectSet()
+            : words() {}
+
+        void set(int index)
+        {
+            words[index >> 6] |= static_cast<uint64_t>(1) << (index & 63);
+        }
+
+        bool test(int index) const
+        {
+            return (words[index >> 6] >> (index & 63)) & 1;
+        }
+
+        template<typename T>
+        void add()
+        {
+            set(ObjectIndex<T>::value);
+        }
+
+        template<typename T>
+        bool contains() const
+        {
+            return test(ObjectIndex<T>::value);
+        }
+
+        bool empty() const
+        {
+            return (words[0] | words[1]) == 0;
+        }
+
+        /** Whether this set and \c other have at least one object in common */
+        bool intersects(ObjectSet const& other) const
+        {
+            return ((words[0] & other.words[0]) | (words[1] & other.words[1])) != 0;
+        }
+
+        /** Whether all the objects of \c other are in this set */
+        bool contains(ObjectSet const& other) const
+        {
+            return (words[0] & other.words[0]) == other.words[0] &&
+                (words[1] & other.words[1]) == other.words[1];
+        }
+
+        void merge(ObjectSet const& other)
+        {
+            words[0] |= other.words[0];
+            words[1] |= other.words[1];
+        }
+    };
+    static_assert(OBJECT_REGISTRY_SIZE <= ObjectSet::CAPACITY,
+        "ObjectSet is too small to hold all the objects of the registry");
+
+    /** Returns the description of an object given its ID and sub ID
+     *
+     * @return the description, or nullptr if the object is unknown
+     */
+    ObjectInfo const* findObject(uint16_t objectId, uint8_t objectSubId);
+
+    /** Returns the description of an object given its name
+     *
+     * @return the description, or nullptr if the object is unknown
+     */
+    ObjectInfo const* findObject(char const* name);
+
+    /** Returns the name of a type */
+    char const* getObjectTypeName(OBJECT_TYPES type);
+
+    /** Returns the size in bytes of a type */
+    size_t getObjectTypeSize(OBJECT_TYPES type);
+
+    /** Calls visitor.visit<Object>() for every object of CANOPEN_OBJECT_LIST
+     *
+     * This is the compile-time equivalent of iterating over OBJECT_REGISTRY
+     */
+    template<typename Visitor>
+    void visitObjects(Visitor& visitor)
+    {
+        #define CANOPEN_VISIT_OBJECT(object_id, object_sub_id, name, type, update_id) \
+            visitor.template visit<name>();
+        CANOPEN_OBJECT_LIST(CANOPEN_VISIT_OBJECT, CANOPEN_VISIT_OBJECT)
+        #undef CANOPEN_VISIT_OBJECT
+    }
+}
+
+#endif
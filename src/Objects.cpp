@@ -1,26 +1,65 @@
 #include <motors_elmo_ds402/Objects.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
 
 using namespace motors_elmo_ds402;
 
-StatusWord::State parseState(uint8_t byte)
+namespace motors_elmo_ds402
 {
-    switch(byte & 0x4F)
+    uint64_t getUpdateID(uint32_t fullId)
     {
-        case 0x00: return StatusWord::NOT_READY_TO_SWITCH_ON;
-        case 0x40: return StatusWord::SWITCH_ON_DISABLED;
-        case 0x0F: return StatusWord::FAULT_REACTION_ACTIVE;
-        case 0x08: return StatusWord::FAULT;
+        int index = findObjectIndex(fullId);
+        return (index == -1) ? 0 : OBJECT_REGISTRY[index].updateId;
     }
+}
 
-    switch(byte & 0x6F)
+namespace {
+    constexpr StatusWord::State computeState(uint8_t byte)
     {
-        case 0x21: return StatusWord::READY_TO_SWITCH_ON;
-        case 0x23: return StatusWord::SWITCH_ON;
-        case 0x27: return StatusWord::OPERATION_ENABLED;
-        case 0x07: return StatusWord::QUICK_STOP_ACTIVE;
+        return ((byte & 0x4F) == 0x00) ? StatusWord::NOT_READY_TO_SWITCH_ON :
+            ((byte & 0x4F) == 0x40) ? StatusWord::SWITCH_ON_DISABLED :
+            ((byte & 0x4F) == 0x0F) ? StatusWord::FAULT_REACTION_ACTIVE :
+            ((byte & 0x4F) == 0x08) ? StatusWord::FAULT :
+            ((byte & 0x6F) == 0x21) ? StatusWord::READY_TO_SWITCH_ON :
+            ((byte & 0x6F) == 0x23) ? StatusWord::SWITCH_ON :
+            ((byte & 0x6F) == 0x27) ? StatusWord::OPERATION_ENABLED :
+            ((byte & 0x6F) == 0x07) ? StatusWord::QUICK_STOP_ACTIVE :
+            StatusWord::INVALID;
     }
 
-    throw StatusWord::UnknownState("received an unknown value for the state");
+    #define STATE_ENTRY(i) static_cast<uint8_t>(computeState(i)),
+    #define STATE_ENTRY_4(i) \
+        STATE_ENTRY(i) STATE_ENTRY(i + 1) STATE_ENTRY(i + 2) STATE_ENTRY(i + 3)
+    #define STATE_ENTRY_16(i) \
+        STATE_ENTRY_4(i) STATE_ENTRY_4(i + 4) STATE_ENTRY_4(i + 8) STATE_ENTRY_4(i + 12)
+    #define STATE_ENTRY_64(i) \
+        STATE_ENTRY_16(i) STATE_ENTRY_16(i + 16) STATE_ENTRY_16(i + 32) STATE_ENTRY_16(i + 48)
+
+    /** State for each possible value of the status word's lower byte */
+    constexpr uint8_t STATE_TABLE[256] = {
+        STATE_ENTRY_64(0) STATE_ENTRY_64(64) STATE_ENTRY_64(128) STATE_ENTRY_64(192)
+    };
+
+    static_assert(STATE_TABLE[0x21] == StatusWord::READY_TO_SWITCH_ON &&
+        STATE_TABLE[0x37] == StatusWord::OPERATION_ENABLED &&
+        STATE_TABLE[0x2F] == StatusWord::FAULT_REACTION_ACTIVE &&
+        STATE_TABLE[0x01] == StatusWord::INVALID,
+        "the status word lookup table is not generated properly");
+}
+
+StatusWord::State StatusWord::parseState(uint16_t raw)
+{
+    return static_cast<StatusWord::State>(STATE_TABLE[raw & 0xFF]);
+}
+
+StatusWord StatusWord::tryParse(uint16_t raw)
+{
+    State state = parseState(raw);
+    bool voltageEnabled = (raw & 0x0010);
+    bool warning        = (raw & 0x0080);
+    bool targetReached  = (raw & 0x0400);
+    bool internalLimitActive = (raw & 0x0800);
+    return StatusWord { raw, state, voltageEnabled, warning,
+        targetReached, internalLimitActive };
 }
 
 namespace motors_elmo_ds402
@@ -63,13 +102,10 @@ namespace motors_elmo_ds402
     template<>
     StatusWord parse<StatusWord, uint16_t>(uint16_t raw)
     {
-        StatusWord::State state = parseState(raw & 0x6F);
-        bool voltageEnabled = (raw & 0x0010);
-        bool warning        = (raw & 0x0080);
-        bool targetReached  = (raw & 0x0400);
-        bool internalLimitActive = (raw & 0x0800);
-        return StatusWord { raw, state, voltageEnabled, warning,
-            targetReached, internalLimitActive };
+        StatusWord status = StatusWord::tryParse(raw);
+        if (!status.isValid())
+            throw StatusWord::UnknownState("received an unknown value for the state");
+        return status;
     }
 
     template<>
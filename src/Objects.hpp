@@ -20,7 +20,8 @@ namespace motors_elmo_ds402
             UPDATE_JOINT_VELOCITY |
             UPDATE_JOINT_CURRENT,
         UPDATE_JOINT_LIMITS   = 0x00000080,
-        UPDATE_OPERATION_MODE = 0x00000100
+        UPDATE_OPERATION_MODE = 0x00000100,
+        UPDATE_DRIVE_TIMESTAMP = 0x00000200
     };
 
     enum OPERATION_MODES
@@ -69,88 +70,114 @@ namespace motors_elmo_ds402
         template<> name parse<name, type>(type value); \
         template<> type encode(name const& value);
 
-    CANOPEN_DEFINE_RO_OBJECT(0x1000, 0, DeviceType,                    std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x1001, 0, ErrorRegister,                 std::uint8_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x1002, 0, ManufacturerStatusRegister,    std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x1016, 2, ConsumerHeartbeatTime,         std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x1017, 0, ProducerHeartbeatTime,         std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x1018, 4, IdentityObject,                std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2041, 0, TimestampUsec,                 std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2081, 5, ExtendedErrorCode,             std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2082, 0, CANControllerStatusRegister,   std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2085, 0, ExtraStatusRegister,           std::int16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2086, 0, STOStatusRegister,             std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2087, 0, PALVersion,                    std::uint16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x2206, 0, DCSupply5V,                    std::uint16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x22A3, 3, Temperature,                   std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x2E06, 0, TorqueWindow,                  std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x2E07, 0, TorqueWindowTime,              std::uint16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x603f, 0, ErrorCode,                     std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6040, 0, ControlWordRegister,           std::uint16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6041, 0, StatusWordRegister,            std::uint16_t, UPDATE_STATUS_WORD);
-    CANOPEN_DEFINE_RW_OBJECT(0x605A, 0, QuickStopOptionCode,           std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x605B, 0, ShutdownOptionCode,            std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x605C, 0, DisableOperationOptionCode,    std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x605D, 0, HaltOptionCode,                std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x605E, 0, FaultReactionOptionCode,       std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6060, 0, ModesOfOperation,              std::int8_t, UPDATE_OPERATION_MODE);
-    CANOPEN_DEFINE_RO_OBJECT(0x6062, 0, PositionDemandValue,           std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6063, 0, PositionActualInternalValue,   std::int32_t, UPDATE_JOINT_POSITION);
-    CANOPEN_DEFINE_RW_OBJECT(0x6065, 0, FollowingErrorWindow,          std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6066, 0, FollowingErrorTimeout,         std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6067, 0, PositionWindow,                std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6068, 0, PositionWindowTimeout,         std::uint32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6069, 0, VelocitySensorActualValue,     std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x606B, 0, VelocityDemandValue,           std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x606C, 0, VelocityActualValue,           std::int32_t, UPDATE_JOINT_VELOCITY);
-    CANOPEN_DEFINE_RW_OBJECT(0x606D, 0, VelocityWindow,                std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x606E, 0, VelocityWindowTime,            std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x606F, 0, VelocityThreshold,             std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6070, 0, VelocityThresholdTime,         std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6071, 0, TargetTorque,                  std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6072, 0, MaxTorque,                     std::uint16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6073, 0, MaxCurrent,                    std::uint16_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RO_OBJECT(0x6074, 0, TorqueDemand,                  std::int16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6075, 0, MotorRatedCurrent,             std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RO_OBJECT(0x6076, 0, MotorRatedTorque,              std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RO_OBJECT(0x6077, 0, TorqueActualValue,             std::int16_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6078, 0, CurrentActualValue,            std::int16_t, UPDATE_JOINT_CURRENT);
-    CANOPEN_DEFINE_RO_OBJECT(0x6079, 0, DCLinkCircuitVoltage,          std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x607A, 0, TargetPosition,                std::int32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x607B, 1, PositionRangeLimitMin,         std::int32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x607B, 2, PositionRangeLimitMax,         std::int32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x607D, 1, SoftwarePositionLimitMin,      std::int32_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RW_OBJECT(0x607D, 2, SoftwarePositionLimitMax,      std::int32_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RW_OBJECT(0x607E, 0, Polarity,                      std::int8_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x607F, 0, MaxProfileVelocity,            std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6080, 0, MaxMotorSpeed,                 std::int32_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6081, 0, ProfileVelocity,               std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6082, 0, EndVelocity,                   std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6083, 0, ProfileAcceleration,           std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6084, 0, ProfileDeceleration,           std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6085, 0, QuickStopDeceleration,         std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6086, 0, MotionProfileType,             std::int16_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x6087, 0, TorqueSlope,                   std::uint32_t, 0);
-    CANOPEN_DEFINE_RW_OBJECT(0x608F, 1, PositionEncoderResolutionNum,  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x608F, 2, PositionEncoderResolutionDen,  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6090, 1, VelocityEncoderResolutionNum,  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6090, 2, VelocityEncoderResolutionDen,  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6091, 1, GearRatioNum,                  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6091, 2, GearRatioDen,                  std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6092, 1, FeedConstantNum,               std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6092, 2, FeedConstantDen,               std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6096, 1, VelocityFactorNum,             std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6096, 2, VelocityFactorDen,             std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6097, 1, AccelerationFactorNum,         std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x6097, 2, AccelerationFactorDen,         std::uint32_t, UPDATE_FACTORS);
-    CANOPEN_DEFINE_RW_OBJECT(0x60C5, 0, MaxAcceleration,               std::int32_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RW_OBJECT(0x60C6, 0, MaxDeceleration,               std::int32_t, UPDATE_JOINT_LIMITS);
-    CANOPEN_DEFINE_RO_OBJECT(0x60F4, 0, FollowingErrorActualValue,     std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x60FA, 0, ControlEffort,                 std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x60FC, 0, PositionDemandInternalValue,   std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x60FF, 0, TargetVelocity,                std::int32_t, 0);
-    CANOPEN_DEFINE_RO_OBJECT(0x6502, 0, SupportedDriveModes,           std::uint32_t, 0);
+    /** The list of all objects known to this library, sorted by object ID and
+     * sub ID
+     *
+     * This is an X-macro: it calls RO(object_id, object_sub_id, name, type,
+     * update_id) for read-only objects and RW(...) with the same arguments for
+     * read-write objects. It is used both to declare the object structures
+     * below and to generate the tables that need to know about all objects
+     */
+    #define CANOPEN_OBJECT_LIST(RO, RW) \
+        RO(0x1000, 0, DeviceType,                    std::uint32_t, 0)                    \
+        RO(0x1001, 0, ErrorRegister,                 std::uint8_t, 0)                     \
+        RO(0x1002, 0, ManufacturerStatusRegister,    std::uint32_t, 0)                    \
+        RW(0x1016, 2, ConsumerHeartbeatTime,         std::uint32_t, 0)                    \
+        RW(0x1017, 0, ProducerHeartbeatTime,         std::uint32_t, 0)                    \
+        RO(0x1018, 1, VendorID,                      std::uint32_t, 0)                    \
+        RO(0x1018, 2, ProductCode,                   std::uint32_t, 0)                    \
+        RO(0x1018, 3, RevisionNumber,                std::uint32_t, 0)                    \
+        RO(0x1018, 4, IdentityObject,                std::uint32_t, 0)                    \
+        RO(0x2041, 0, TimestampUsec,                 std::uint32_t, UPDATE_DRIVE_TIMESTAMP) \
+        RO(0x2081, 5, ExtendedErrorCode,             std::int32_t, 0)                     \
+        RO(0x2082, 0, CANControllerStatusRegister,   std::uint32_t, 0)                    \
+        RO(0x2085, 0, ExtraStatusRegister,           std::int16_t, 0)                     \
+        RO(0x2086, 0, STOStatusRegister,             std::uint32_t, 0)                    \
+        RO(0x2087, 0, PALVersion,                    std::uint16_t, 0)                    \
+        RO(0x2206, 0, DCSupply5V,                    std::uint16_t, 0)                    \
+        RO(0x22A3, 3, Temperature,                   std::uint16_t, 0)                    \
+        RW(0x2E06, 0, TorqueWindow,                  std::uint16_t, 0)                    \
+        RW(0x2E07, 0, TorqueWindowTime,              std::uint16_t, 0)                    \
+        RO(0x603f, 0, ErrorCode,                     std::uint16_t, 0)                    \
+        RW(0x6040, 0, ControlWordRegister,           std::uint16_t, 0)                    \
+        RO(0x6041, 0, StatusWordRegister,            std::uint16_t, UPDATE_STATUS_WORD)   \
+        RW(0x605A, 0, QuickStopOptionCode,           std::int16_t, 0)                     \
+        RW(0x605B, 0, ShutdownOptionCode,            std::int16_t, 0)                     \
+        RW(0x605C, 0, DisableOperationOptionCode,    std::int16_t, 0)                     \
+        RW(0x605D, 0, HaltOptionCode,                std::int16_t, 0)                     \
+        RW(0x605E, 0, FaultReactionOptionCode,       std::int16_t, 0)                     \
+        RW(0x6060, 0, ModesOfOperation,              std::int8_t, UPDATE_OPERATION_MODE)  \
+        RO(0x6062, 0, PositionDemandValue,           std::int32_t, 0)                     \
+        RO(0x6063, 0, PositionActualInternalValue,   std::int32_t, UPDATE_JOINT_POSITION) \
+        RW(0x6065, 0, FollowingErrorWindow,          std::uint32_t, 0)                    \
+        RW(0x6066, 0, FollowingErrorTimeout,         std::uint16_t, 0)                    \
+        RW(0x6067, 0, PositionWindow,                std::uint32_t, 0)                    \
+        RW(0x6068, 0, PositionWindowTimeout,         std::uint32_t, 0)                    \
+        RO(0x6069, 0, VelocitySensorActualValue,     std::int32_t, 0)                     \
+        RO(0x606B, 0, VelocityDemandValue,           std::int32_t, 0)                     \
+        RO(0x606C, 0, VelocityActualValue,           std::int32_t, UPDATE_JOINT_VELOCITY) \
+        RW(0x606D, 0, VelocityWindow,                std::uint16_t, 0)                    \
+        RW(0x606E, 0, VelocityWindowTime,            std::uint16_t, 0)                    \
+        RW(0x606F, 0, VelocityThreshold,             std::uint16_t, 0)                    \
+        RW(0x6070, 0, VelocityThresholdTime,         std::uint16_t, 0)                    \
+        RW(0x6071, 0, TargetTorque,                  std::int16_t, 0)                     \
+        RW(0x6072, 0, MaxTorque,                     std::uint16_t, 0)                    \
+        RW(0x6073, 0, MaxCurrent,                    std::uint16_t, UPDATE_JOINT_LIMITS)  \
+        RO(0x6074, 0, TorqueDemand,                  std::int16_t, 0)                     \
+        RO(0x6075, 0, MotorRatedCurrent,             std::uint32_t, UPDATE_FACTORS)       \
+        RO(0x6076, 0, MotorRatedTorque,              std::uint32_t, UPDATE_FACTORS)       \
+        RO(0x6077, 0, TorqueActualValue,             std::int16_t, 0)                     \
+        RO(0x6078, 0, CurrentActualValue,            std::int16_t, UPDATE_JOINT_CURRENT)  \
+        RO(0x6079, 0, DCLinkCircuitVoltage,          std::uint32_t, 0)                    \
+        RW(0x607A, 0, TargetPosition,                std::int32_t, 0)                     \
+        RW(0x607B, 1, PositionRangeLimitMin,         std::int32_t, 0)                     \
+        RW(0x607B, 2, PositionRangeLimitMax,         std::int32_t, 0)                     \
+        RW(0x607D, 1, SoftwarePositionLimitMin,      std::int32_t, UPDATE_JOINT_LIMITS)   \
+        RW(0x607D, 2, SoftwarePositionLimitMax,      std::int32_t, UPDATE_JOINT_LIMITS)   \
+        RW(0x607E, 0, Polarity,                      std::int8_t, 0)                      \
+        RW(0x607F, 0, MaxProfileVelocity,            std::uint32_t, 0)                    \
+        RW(0x6080, 0, MaxMotorSpeed,                 std::int32_t, UPDATE_JOINT_LIMITS)   \
+        RW(0x6081, 0, ProfileVelocity,               std::uint32_t, 0)                    \
+        RW(0x6082, 0, EndVelocity,                   std::uint32_t, 0)                    \
+        RW(0x6083, 0, ProfileAcceleration,           std::uint32_t, 0)                    \
+        RW(0x6084, 0, ProfileDeceleration,           std::uint32_t, 0)                    \
+        RW(0x6085, 0, QuickStopDeceleration,         std::uint32_t, 0)                    \
+        RW(0x6086, 0, MotionProfileType,             std::int16_t, 0)                     \
+        RW(0x6087, 0, TorqueSlope,                   std::uint32_t, 0)                    \
+        RW(0x608F, 1, PositionEncoderResolutionNum,  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x608F, 2, PositionEncoderResolutionDen,  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6090, 1, VelocityEncoderResolutionNum,  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6090, 2, VelocityEncoderResolutionDen,  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6091, 1, GearRatioNum,                  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6091, 2, GearRatioDen,                  std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6092, 1, FeedConstantNum,               std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6092, 2, FeedConstantDen,               std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6096, 1, VelocityFactorNum,             std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6096, 2, VelocityFactorDen,             std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6097, 1, AccelerationFactorNum,         std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x6097, 2, AccelerationFactorDen,         std::uint32_t, UPDATE_FACTORS)       \
+        RW(0x60B1, 0, VelocityOffset,                std::int32_t, 0)                     \
+        RW(0x60B2, 0, TorqueOffset,                  std::int16_t, 0)                     \
+        RW(0x60C2, 1, InterpolationTimePeriodValue,  std::uint8_t, 0)                     \
+        RW(0x60C2, 2, InterpolationTimeIndex,        std::int8_t, 0)                      \
+        RW(0x60C5, 0, MaxAcceleration,               std::int32_t, UPDATE_JOINT_LIMITS)   \
+        RW(0x60C6, 0, MaxDeceleration,               std::int32_t, UPDATE_JOINT_LIMITS)   \
+        RO(0x60F4, 0, FollowingErrorActualValue,     std::int32_t, 0)                     \
+        RO(0x60FA, 0, ControlEffort,                 std::int32_t, 0)                     \
+        RO(0x60FC, 0, PositionDemandInternalValue,   std::int32_t, 0)                     \
+        RO(0x60FD, 0, DigitalInputs,                 std::uint32_t, 0)                    \
+        RW(0x60FF, 0, TargetVelocity,                std::int32_t, 0)                     \
+        RO(0x6502, 0, SupportedDriveModes,           std::uint32_t, 0)
 
+    CANOPEN_OBJECT_LIST(CANOPEN_DEFINE_RO_OBJECT, CANOPEN_DEFINE_RW_OBJECT)
+
+    /** Returns the UPDATE_ID of an object given its full ID
+     *
+     * The full ID is (OBJECT_ID << 8 | OBJECT_SUB_ID). The lookup is done in
+     * OBJECT_REGISTRY (see ObjectRegistry.hpp). It returns zero for objects
+     * that are not part of the list.
+     */
+    uint64_t getUpdateID(uint32_t fullId);
 
     /** Representation of the heartbeat (NMT state)
      */
@@ -184,23 +211,36 @@ namespace motors_elmo_ds402
         bool enable_halt;
     };
 
+    /** The states of the DS402 drive state machine
+     *
+     * This is an X-macro: it calls STATE(name) for each value of
+     * StatusWord::State, in order. It is used to declare the enum and to
+     * generate the tables that need the state names. INVALID is returned by
+     * StatusWord::tryParse when the state bits do not match a known state
+     */
+    #define STATUS_WORD_STATE_LIST(STATE) \
+        STATE(NOT_READY_TO_SWITCH_ON) \
+        STATE(SWITCH_ON_DISABLED)     \
+        STATE(READY_TO_SWITCH_ON)     \
+        STATE(SWITCH_ON)              \
+        STATE(OPERATION_ENABLED)      \
+        STATE(QUICK_STOP_ACTIVE)      \
+        STATE(FAULT_REACTION_ACTIVE)  \
+        STATE(FAULT)                  \
+        STATE(INVALID)
+
     /** Representation of the status word
      *
      * The status word is the main representation of the drive's state
      */
     struct StatusWord : StatusWordRegister
     {
+        #define STATUS_WORD_STATE_ENUM(name) name,
         enum State
         {
-            NOT_READY_TO_SWITCH_ON,
-            SWITCH_ON_DISABLED,
-            READY_TO_SWITCH_ON,
-            SWITCH_ON,
-            OPERATION_ENABLED,
-            QUICK_STOP_ACTIVE,
-            FAULT_REACTION_ACTIVE,
-            FAULT
+            STATUS_WORD_STATE_LIST(STATUS_WORD_STATE_ENUM)
         };
+        #undef STATUS_WORD_STATE_ENUM
 
         struct UnknownState : public std::runtime_error
         {
@@ -221,6 +261,26 @@ namespace motors_elmo_ds402
             , warning(warning)
             , targetReached(targetReached)
             , internalLimitActive(internalLimitActive) {}
+
+        /** Decode the state from a raw status word
+         *
+         * It uses a lookup table over the status word's lower byte, and
+         * returns INVALID instead of throwing
+         */
+        static State parseState(uint16_t raw);
+
+        /** Decode a raw status word without throwing
+         *
+         * If the state bits do not match a known state, the returned object's
+         * state is INVALID
+         */
+        static StatusWord tryParse(uint16_t raw);
+
+        /** Whether the state is a known one */
+        bool isValid() const
+        {
+            return state != INVALID;
+        }
     };
 
     struct CANControllerStatus : public CANControllerStatusRegister
@@ -0,0 +1,94 @@
+#include <motors_elmo_ds402/SDOAbort.hpp>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+namespace {
+    struct AbortDescription
+    {
+        uint32_t code;
+        char const* description;
+    };
+
+    AbortDescription const ABORT_DESCRIPTIONS[] = {
+        { 0x05030000, "toggle bit not alternated" },
+        { 0x05040000, "SDO protocol timed out" },
+        { 0x05040001, "client/server command specifier not valid or unknown" },
+        { 0x05040002, "invalid block size" },
+        { 0x05040003, "invalid sequence number" },
+        { 0x05040004, "CRC error" },
+        { 0x05040005, "out of memory" },
+        { 0x06010000, "unsupported access to an object" },
+        { 0x06010001, "attempt to read a write only object" },
+        { 0x06010002, "attempt to write a read only object" },
+        { 0x06020000, "object does not exist in the object dictionary" },
+        { 0x06040041, "object cannot be mapped to the PDO" },
+        { 0x06040042, "the number and length of the objects to be mapped would exceed PDO length" },
+        { 0x06040043, "general parameter incompatibility" },
+        { 0x06040047, "general internal incompatibility in the device" },
+        { 0x06060000, "access failed due to a hardware error" },
+        { 0x06070010, "data type does not match, length of service parameter does not match" },
+        { 0x06070012, "data type does not match, length of service parameter too high" },
+        { 0x06070013, "data type does not match, length of service parameter too low" },
+        { 0x06090011, "sub-index does not exist" },
+        { 0x06090030, "invalid value for parameter" },
+        { 0x06090031, "value of parameter written too high" },
+        { 0x06090032, "value of parameter written too low" },
+        { 0x06090036, "maximum value is less than minimum value" },
+        { 0x060A0023, "resource not available: SDO connection" },
+        { 0x08000000, "general error" },
+        { 0x08000020, "data cannot be transferred or stored to the application" },
+        { 0x08000021, "data cannot be transferred or stored to the application because of local control" },
+        { 0x08000022, "data cannot be transferred or stored to the application because of the present device state" },
+        { 0x08000023, "object dictionary dynamic generation fails or no object dictionary is present" },
+        { 0x08000024, "no data available" }
+    };
+
+    string formatObject(ObjectID const& object)
+    {
+        ostringstream stream;
+        stream << hex << setfill('0') << "0x" << setw(4) << object.id
+            << "." << setw(2) << static_cast<int>(object.subId);
+        ObjectInfo const* info = findObject(object.id, object.subId);
+        if (info)
+            stream << " (" << info->name << ")";
+        return stream.str();
+    }
+
+    string formatAbort(SDOAbort const& abort)
+    {
+        ostringstream stream;
+        stream << "SDO transfer of " << formatObject(abort.object)
+            << " aborted: " << getSDOAbortDescription(abort.code)
+            << " (code 0x" << hex << setfill('0') << setw(8) << abort.code << ")";
+        return stream.str();
+    }
+}
+
+namespace motors_elmo_ds402
+{
+    char const* getSDOAbortDescription(uint32_t code)
+    {
+        for (AbortDescription const& description : ABORT_DESCRIPTIONS)
+        {
+            if (description.code == code)
+                return description.description;
+        }
+        return "unknown abort code";
+    }
+
+    SDOAbortError::SDOAbortError(SDOAbort const& abort)
+        : std::runtime_error(formatAbort(abort))
+        , abort(abort)
+    {
+    }
+
+    SDOTimeout::SDOTimeout(ObjectID const& object)
+        : std::runtime_error("timed out waiting for the answer to the SDO transfer of " +
+            formatObject(object))
+        , object(object)
+    {
+    }
+}
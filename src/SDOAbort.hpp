@@ -0,0 +1,42 @@
+#ifndef MOTORS_ELMO_DS402_SDO_ABORT_HPP
+#define MOTORS_ELMO_DS402_SDO_ABORT_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** An SDO transfer that has been aborted by the drive */
+    struct SDOAbort
+    {
+        ObjectID object;
+        /** The abort code as defined in CiA 301 */
+        uint32_t code;
+    };
+
+    /** Returns the CiA 301 description of an SDO abort code
+     *
+     * Returns "unknown abort code" for codes that are not defined by the
+     * standard
+     */
+    char const* getSDOAbortDescription(uint32_t code);
+
+    /** Exception that represents an aborted SDO transfer */
+    struct SDOAbortError : public std::runtime_error
+    {
+        SDOAbort abort;
+
+        explicit SDOAbortError(SDOAbort const& abort);
+    };
+
+    /** Exception thrown when the drive did not answer an SDO request in time */
+    struct SDOTimeout : public std::runtime_error
+    {
+        ObjectID object;
+
+        explicit SDOTimeout(ObjectID const& object);
+    };
+}
+
+#endif
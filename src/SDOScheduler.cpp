@@ -0,0 +1,105 @@
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+SDOScheduler::SDOScheduler(SDOTransactionQueue::Policy const& policy)
+    : mPolicy(policy)
+{
+}
+
+int SDOScheduler::add(Controller& controller)
+{
+    if (findNode(controller.getNodeId()) != -1)
+        throw std::invalid_argument("a controller is already registered for this node");
+
+    mNodes.push_back(Node { &controller,
+        SDOTransactionQueue(controller.getNodeId(), mPolicy) });
+    return mNodes.size() - 1;
+}
+
+void SDOScheduler::push(int index, vector<canbus::Message> const& messages)
+{
+    mNodes.at(index).queue.push(messages);
+}
+
+void SDOScheduler::push(int index, canbus::Message const& message)
+{
+    mNodes.at(index).queue.push(message);
+}
+
+size_t SDOScheduler::next(base::Time const& now, vector<canbus::Message>& messages)
+{
+    size_t count = 0;
+    canbus::Message message;
+    for (Node& node : mNodes)
+    {
+        // Non-SDO messages are completed as soon as they are sent, which is
+        // why we need a loop
+        while (node.queue.next(now, message))
+        {
+            messages.push_back(message);
+            ++count;
+        }
+    }
+    return count;
+}
+
+int SDOScheduler::findNode(uint8_t nodeId) const
+{
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        if (mNodes[i].controller->getNodeId() == nodeId)
+            return i;
+    }
+    return -1;
+}
+
+Update SDOScheduler::process(canbus::Message const& message)
+{
+    // All the COB-IDs of the predefined connection set end with the node ID
+    int index = findNode(message.can_id & 0x7F);
+    if (index == -1)
+        return Update();
+
+    Node& node = mNodes[index];
+    Update update = node.controller->process(message);
+    node.queue.process(update);
+    return update;
+}
+
+bool SDOScheduler::isDone() const
+{
+    for (Node const& node : mNodes)
+    {
+        if (!node.queue.isDone())
+            return false;
+    }
+    return true;
+}
+
+bool SDOScheduler::hasFailed() const
+{
+    for (Node const& node : mNodes)
+    {
+        if (node.queue.hasFailed())
+            return true;
+    }
+    return false;
+}
+
+size_t SDOScheduler::size() const
+{
+    return mNodes.size();
+}
+
+Controller& SDOScheduler::getController(int index)
+{
+    return *mNodes.at(index).controller;
+}
+
+SDOTransactionQueue const& SDOScheduler::getQueue(int index) const
+{
+    return mNodes.at(index).queue;
+}
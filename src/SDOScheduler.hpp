@@ -0,0 +1,95 @@
+#ifndef MOTORS_ELMO_DS402_SDO_SCHEDULER_HPP
+#define MOTORS_ELMO_DS402_SDO_SCHEDULER_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/SDOTransactionQueue.hpp>
+
+namespace motors_elmo_ds402
+{
+    class Controller;
+
+    /** Runs SDO transfers on several nodes of the same bus in parallel
+     *
+     * CANopen allows only one SDO transfer in flight per node, but nothing
+     * prevents talking to all nodes at the same time. The scheduler holds
+     * one SDOTransactionQueue per controller and keeps one transfer in flight
+     * on each node, so that the time needed to e.g. configure all drives is
+     * the one of the slowest drive instead of the sum of all of them.
+     *
+     * Like SDOTransactionQueue, it does no I/O by itself. Call next() to get
+     * the messages that should be sent, and process() with all the messages
+     * received on the bus.
+     */
+    class SDOScheduler
+    {
+    public:
+        explicit SDOScheduler(
+            SDOTransactionQueue::Policy const& policy = SDOTransactionQueue::Policy());
+
+        /** Register a controller
+         *
+         * The controller must remain valid for the lifetime of the
+         * scheduler, and there must be only one controller per node
+         *
+         * @return the controller's index in the scheduler
+         */
+        int add(Controller& controller);
+
+        /** Queue messages for the given controller
+         *
+         * @param index the index returned by add()
+         * @param messages the messages to send, as returned by e.g.
+         *   Controller::queryFactors or Controller::configureJointStateUpdatePDOs
+         */
+        void push(int index, std::vector<canbus::Message> const& messages);
+
+        /** Queue a single message for the given controller */
+        void push(int index, canbus::Message const& message);
+
+        /** Appends the messages that should be sent now to \c messages
+         *
+         * @return the number of messages that have been added
+         */
+        size_t next(base::Time const& now, std::vector<canbus::Message>& messages);
+
+        /** Process a message received on the bus
+         *
+         * The message is passed to the process() method of the controller of
+         * the node it comes from, and the resulting update is used to advance
+         * this node's queue. Messages that are not from a registered node are
+         * ignored.
+         *
+         * @return the update returned by Controller::process
+         */
+        Update process(canbus::Message const& message);
+
+        /** Whether all queues are done, successfully or not */
+        bool isDone() const;
+
+        /** Whether a transfer failed on at least one node */
+        bool hasFailed() const;
+
+        /** Number of registered controllers */
+        size_t size() const;
+
+        /** Returns the controller registered at the given index */
+        Controller& getController(int index);
+
+        /** Returns the queue of the controller registered at the given index */
+        SDOTransactionQueue const& getQueue(int index) const;
+
+    private:
+        struct Node
+        {
+            Controller* controller;
+            SDOTransactionQueue queue;
+        };
+
+        SDOTransactionQueue::Policy mPolicy;
+        std::vector<Node> mNodes;
+
+        int findNode(uint8_t nodeId) const;
+    };
+}
+
+#endif
@@ -0,0 +1,369 @@
+#include <motors_elmo_ds402/SDOSegmentedTransfer.hpp>
+#include "CANopenProtocol.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const uint32_t ABORT_TOGGLE_BIT = 0x05030000;
+static const uint32_t ABORT_INVALID_COMMAND = 0x05040001;
+static const uint32_t ABORT_INVALID_BLOCK_SIZE = 0x05040002;
+static const uint32_t ABORT_CRC_ERROR = 0x05040004;
+static const uint32_t ABORT_GENERAL_ERROR = 0x08000000;
+
+/** CRC used by the block transfers (CRC-16-CCITT, initial value 0) */
+static uint16_t updateCRC(uint16_t crc, uint8_t const* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+SDOSegmentedTransfer::SDOSegmentedTransfer(uint8_t nodeId)
+    : mNodeId(nodeId)
+{
+}
+
+canbus::Message SDOSegmentedTransfer::makeRequest(uint8_t command) const
+{
+    canbus::Message msg;
+    msg.can_id = SDO_CLIENT_COB_ID + mNodeId;
+    msg.size = 8;
+    std::memset(msg.data, 0, 8);
+    msg.data[0] = command;
+    return msg;
+}
+
+canbus::Message SDOSegmentedTransfer::makeInitiateRequest(uint8_t command) const
+{
+    canbus::Message msg = makeRequest(command);
+    msg.data[1] = mObject.id & 0xFF;
+    msg.data[2] = mObject.id >> 8;
+    msg.data[3] = mObject.subId;
+    return msg;
+}
+
+canbus::Message SDOSegmentedTransfer::upload(uint16_t objectId, uint8_t objectSubId,
+    Sink sink, TRANSFER_MODES mode, uint8_t blockSize)
+{
+    if (mState == TRANSFER_RUNNING)
+        throw std::logic_error("a transfer is already running");
+    if (mode == TRANSFER_BLOCK && (blockSize < 1 || blockSize > 127))
+        throw std::invalid_argument("block size must be between 1 and 127");
+
+    mObject = ObjectID { objectId, objectSubId };
+    mSink = sink;
+    mSize = 0;
+    mTransferred = 0;
+    mState = TRANSFER_RUNNING;
+    // Only set by the server in a block upload
+    mUseCRC = false;
+
+    if (mode == TRANSFER_SEGMENTED)
+    {
+        mPhase = UPLOAD_INITIATE;
+        return makeInitiateRequest(SDO_INITIATE_UPLOAD_REQUEST);
+    }
+
+    mPhase = BLOCK_UPLOAD_INITIATE;
+    mBlockSize = blockSize;
+    mCRC = 0;
+    mHasPending = false;
+    mLastSegment = false;
+    // Announce CRC support
+    canbus::Message msg = makeInitiateRequest(SDO_BLOCK_UPLOAD_INITIATE_REQUEST | 0x04);
+    msg.data[4] = blockSize;
+    // Protocol switch threshold. Zero disables the switch to the segmented
+    // protocol
+    msg.data[5] = 0;
+    return msg;
+}
+
+canbus::Message SDOSegmentedTransfer::download(uint16_t objectId, uint8_t objectSubId,
+    uint32_t size, Source source)
+{
+    if (mState == TRANSFER_RUNNING)
+        throw std::logic_error("a transfer is already running");
+
+    mObject = ObjectID { objectId, objectSubId };
+    mSource = source;
+    mSize = size;
+    mTransferred = 0;
+    mState = TRANSFER_RUNNING;
+    mPhase = DOWNLOAD_INITIATE;
+
+    if (size <= 4)
+    {
+        // Expedited transfer, with the size indicated
+        uint8_t unused = 4 - size;
+        canbus::Message msg = makeInitiateRequest(
+            SDO_INITIATE_DOWNLOAD_REQUEST | unused << 2 | 0x03);
+        if (source(msg.data + 4, size) != size)
+        {
+            mState = TRANSFER_FAILED;
+            mAbort = SDOAbort { mObject, ABORT_GENERAL_ERROR };
+            throw std::invalid_argument("source returned less data than announced");
+        }
+        mTransferred = size;
+        return msg;
+    }
+
+    // Segmented transfer, with the size indicated
+    canbus::Message msg = makeInitiateRequest(SDO_INITIATE_DOWNLOAD_REQUEST | 0x01);
+    encodeUInt32(msg.data + 4, size);
+    return msg;
+}
+
+canbus::Message SDOSegmentedTransfer::abort(uint32_t code)
+{
+    canbus::Message msg = makeInitiateRequest(SDO_ABORT_COMMAND);
+    encodeUInt32(msg.data + 4, code);
+    mState = TRANSFER_FAILED;
+    mAbort = SDOAbort { mObject, code };
+    return msg;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::failLocally(
+    uint32_t code, canbus::Message& reply)
+{
+    reply = abort(code);
+    return PROCESS_REPLY;
+}
+
+void SDOSegmentedTransfer::deliver(uint8_t const* data, size_t size)
+{
+    if (mUseCRC)
+        mCRC = updateCRC(mCRC, data, size);
+    mTransferred += size;
+    if (mSink)
+        mSink(data, size);
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::process(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if (mState != TRANSFER_RUNNING ||
+        msg.can_id != SDO_SERVER_COB_ID + mNodeId || msg.size != 8)
+        return PROCESS_IGNORED;
+
+    // During a block upload, the frames contain a sequence number in the
+    // first byte. 0x80 would be sequence number zero, which is invalid, so
+    // this test is valid in all phases
+    if (msg.data[0] == SDO_ABORT_COMMAND)
+    {
+        mState = TRANSFER_FAILED;
+        mAbort = SDOAbort {
+            ObjectID { static_cast<uint16_t>(msg.data[1] | msg.data[2] << 8), msg.data[3] },
+            decodeUInt32(msg.data + 4) };
+        return PROCESS_CONSUMED;
+    }
+
+    switch(mPhase)
+    {
+        case UPLOAD_INITIATE: return processUploadInitiate(msg, reply);
+        case UPLOAD_SEGMENT: return processUploadSegment(msg, reply);
+        case BLOCK_UPLOAD_INITIATE: return processBlockUploadInitiate(msg, reply);
+        case BLOCK_UPLOAD_DATA: return processBlockUploadData(msg, reply);
+        case BLOCK_UPLOAD_END: return processBlockUploadEnd(msg, reply);
+        case DOWNLOAD_INITIATE:
+        case DOWNLOAD_SEGMENT: return processDownloadAck(msg, reply);
+    }
+    return PROCESS_IGNORED;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processUploadInitiate(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if ((msg.data[0] & SDO_COMMAND_MASK) != SDO_INITIATE_UPLOAD_RESPONSE)
+        return failLocally(ABORT_INVALID_COMMAND, reply);
+
+    bool expedited = msg.data[0] & 0x02;
+    bool sizeIndicated = msg.data[0] & 0x01;
+    if (expedited)
+    {
+        size_t size = sizeIndicated ? 4 - ((msg.data[0] >> 2) & 0x3) : 4;
+        mSize = size;
+        deliver(msg.data + 4, size);
+        mState = TRANSFER_COMPLETED;
+        return PROCESS_CONSUMED;
+    }
+
+    if (sizeIndicated)
+        mSize = decodeUInt32(msg.data + 4);
+    mPhase = UPLOAD_SEGMENT;
+    mToggle = 0;
+    reply = makeRequest(SDO_UPLOAD_SEGMENT_REQUEST);
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processUploadSegment(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if ((msg.data[0] & SDO_COMMAND_MASK) != SDO_UPLOAD_SEGMENT_RESPONSE)
+        return failLocally(ABORT_INVALID_COMMAND, reply);
+    if (((msg.data[0] >> 4) & 0x1) != mToggle)
+        return failLocally(ABORT_TOGGLE_BIT, reply);
+
+    size_t size = 7 - ((msg.data[0] >> 1) & 0x7);
+    deliver(msg.data + 1, size);
+    if (msg.data[0] & 0x01)
+    {
+        mState = TRANSFER_COMPLETED;
+        return PROCESS_CONSUMED;
+    }
+
+    mToggle ^= 1;
+    reply = makeRequest(SDO_UPLOAD_SEGMENT_REQUEST | mToggle << 4);
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processBlockUploadInitiate(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if ((msg.data[0] & 0xE1) != 0xC0)
+        return failLocally(ABORT_INVALID_COMMAND, reply);
+
+    mUseCRC = msg.data[0] & 0x04;
+    if (msg.data[0] & 0x02)
+        mSize = decodeUInt32(msg.data + 4);
+    mPhase = BLOCK_UPLOAD_DATA;
+    mExpectedSequence = 1;
+    mLastGoodSequence = 0;
+    reply = makeRequest(SDO_BLOCK_UPLOAD_START_REQUEST);
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processBlockUploadData(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    uint8_t sequence = msg.data[0] & 0x7F;
+    bool last = msg.data[0] & 0x80;
+    if (sequence == 0 || sequence > mBlockSize)
+        return failLocally(ABORT_INVALID_BLOCK_SIZE, reply);
+
+    if (sequence == mExpectedSequence)
+    {
+        // The number of valid bytes in the last segment is only known at
+        // the end of the transfer. Keep one segment pending so that we can
+        // deliver only the valid bytes
+        if (mHasPending)
+            deliver(mPending, 7);
+        std::memcpy(mPending, msg.data + 1, 7);
+        mHasPending = true;
+        mLastGoodSequence = sequence;
+        ++mExpectedSequence;
+        mLastSegment = last;
+    }
+    // else: out of sequence, ignored. The ack makes the server re-send the
+    // segments after the last good one
+
+    if (!last && sequence != mBlockSize)
+        return PROCESS_CONSUMED;
+
+    reply = makeRequest(SDO_BLOCK_UPLOAD_ACK_REQUEST);
+    reply.data[1] = mLastGoodSequence;
+    reply.data[2] = mBlockSize;
+    mExpectedSequence = 1;
+    mLastGoodSequence = 0;
+    if (mLastSegment)
+        mPhase = BLOCK_UPLOAD_END;
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processBlockUploadEnd(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if ((msg.data[0] & 0xE3) != 0xC1)
+        return failLocally(ABORT_INVALID_COMMAND, reply);
+
+    size_t unused = (msg.data[0] >> 2) & 0x7;
+    if (mHasPending)
+        deliver(mPending, 7 - unused);
+    mHasPending = false;
+
+    if (mUseCRC)
+    {
+        uint16_t crc = msg.data[1] | msg.data[2] << 8;
+        if (crc != mCRC)
+            return failLocally(ABORT_CRC_ERROR, reply);
+    }
+
+    mState = TRANSFER_COMPLETED;
+    reply = makeRequest(SDO_BLOCK_UPLOAD_END_REQUEST);
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::processDownloadAck(
+    canbus::Message const& msg, canbus::Message& reply)
+{
+    if (mPhase == DOWNLOAD_INITIATE)
+    {
+        if (msg.data[0] != SDO_INITIATE_DOWNLOAD_RESPONSE)
+            return failLocally(ABORT_INVALID_COMMAND, reply);
+        if (mTransferred == mSize)
+        {
+            // Expedited transfer
+            mState = TRANSFER_COMPLETED;
+            return PROCESS_CONSUMED;
+        }
+
+        mPhase = DOWNLOAD_SEGMENT;
+        mToggle = 0;
+        return sendDownloadSegment(reply);
+    }
+
+    if ((msg.data[0] & SDO_COMMAND_MASK) != SDO_DOWNLOAD_SEGMENT_RESPONSE)
+        return failLocally(ABORT_INVALID_COMMAND, reply);
+    if (((msg.data[0] >> 4) & 0x1) != mToggle)
+        return failLocally(ABORT_TOGGLE_BIT, reply);
+
+    if (mTransferred == mSize)
+    {
+        mState = TRANSFER_COMPLETED;
+        return PROCESS_CONSUMED;
+    }
+
+    mToggle ^= 1;
+    return sendDownloadSegment(reply);
+}
+
+SDOSegmentedTransfer::PROCESS_RESULTS SDOSegmentedTransfer::sendDownloadSegment(
+    canbus::Message& reply)
+{
+    size_t size = std::min<size_t>(7, mSize - mTransferred);
+    canbus::Message msg = makeRequest(0);
+    if (mSource(msg.data + 1, size) != size)
+        return failLocally(ABORT_GENERAL_ERROR, reply);
+
+    mTransferred += size;
+    bool last = (mTransferred == mSize);
+    msg.data[0] = mToggle << 4 | (7 - size) << 1 | (last ? 1 : 0);
+    reply = msg;
+    return PROCESS_REPLY;
+}
+
+SDOSegmentedTransfer::TRANSFER_STATES SDOSegmentedTransfer::getState() const
+{
+    return mState;
+}
+
+uint32_t SDOSegmentedTransfer::getSize() const
+{
+    return mSize;
+}
+
+uint32_t SDOSegmentedTransfer::getTransferred() const
+{
+    return mTransferred;
+}
+
+SDOAbort SDOSegmentedTransfer::getAbort() const
+{
+    return mAbort;
+}
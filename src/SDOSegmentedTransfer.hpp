@@ -0,0 +1,168 @@
+#ifndef MOTORS_ELMO_DS402_SDO_SEGMENTED_TRANSFER_HPP
+#define MOTORS_ELMO_DS402_SDO_SEGMENTED_TRANSFER_HPP
+
+#include <functional>
+#include <canbus/Message.hpp>
+#include <motors_elmo_ds402/SDOAbort.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Segmented and block SDO transfers
+     *
+     * Controller only does expedited transfers, which are limited to 4
+     * bytes. This class implements the SDO protocols that allow to transfer
+     * larger objects (recorder buffer, strings, ...): segmented upload and
+     * download, and block upload.
+     *
+     * It handles one transfer at a time for a given node. Start a transfer
+     * with upload() or download() and send the returned message, then pass
+     * the received messages to process() and send the replies it returns.
+     * The messages consumed by process() must not be given to
+     * Controller::process.
+     *
+     * Uploaded data is streamed to a sink callback as it arrives. For
+     * segmented uploads, the callback receives a pointer into the received
+     * frame, without any intermediate copy.
+     */
+    class SDOSegmentedTransfer
+    {
+    public:
+        /** Callback that receives the uploaded data
+         *
+         * The pointer is only valid during the call
+         */
+        typedef std::function<void (uint8_t const* data, size_t size)> Sink;
+
+        /** Callback that provides the data to download
+         *
+         * It must write at most \c size bytes in \c buffer and return the
+         * number of bytes written. The transfer is aborted if it returns
+         * less data than the size given to download()
+         */
+        typedef std::function<size_t (uint8_t* buffer, size_t size)> Source;
+
+        enum TRANSFER_MODES
+        {
+            TRANSFER_SEGMENTED,
+            TRANSFER_BLOCK
+        };
+
+        enum TRANSFER_STATES
+        {
+            TRANSFER_IDLE,
+            TRANSFER_RUNNING,
+            TRANSFER_COMPLETED,
+            TRANSFER_FAILED
+        };
+
+        enum PROCESS_RESULTS
+        {
+            /** The message is not part of the transfer */
+            PROCESS_IGNORED,
+            /** The message has been consumed by the transfer */
+            PROCESS_CONSUMED,
+            /** The message has been consumed, and the reply must be sent */
+            PROCESS_REPLY
+        };
+
+        explicit SDOSegmentedTransfer(uint8_t nodeId);
+
+        /** Start uploading an object
+         *
+         * @param mode whether to use the segmented or the block protocol.
+         *   The block protocol has one ack every blockSize frames instead of
+         *   one ack per frame
+         * @param blockSize number of segments per block, between 1 and 127
+         * @return the message that must be sent to start the transfer
+         */
+        canbus::Message upload(uint16_t objectId, uint8_t objectSubId, Sink sink,
+            TRANSFER_MODES mode = TRANSFER_SEGMENTED, uint8_t blockSize = 127);
+
+        /** Start downloading an object using the segmented protocol
+         *
+         * Objects of 4 bytes or less are downloaded with an expedited
+         * transfer
+         *
+         * @return the message that must be sent to start the transfer
+         */
+        canbus::Message download(uint16_t objectId, uint8_t objectSubId,
+            uint32_t size, Source source);
+
+        /** Process a message received from the node
+         *
+         * @param reply set to the message that must be sent if the method
+         *   returns PROCESS_REPLY
+         */
+        PROCESS_RESULTS process(canbus::Message const& msg, canbus::Message& reply);
+
+        /** Abort the current transfer
+         *
+         * @return the abort message that must be sent to the node
+         */
+        canbus::Message abort(uint32_t code);
+
+        TRANSFER_STATES getState() const;
+
+        /** Size of the data as announced by the node or given to download()
+         *
+         * It is zero if the size is not known
+         */
+        uint32_t getSize() const;
+
+        /** Number of bytes transferred so far */
+        uint32_t getTransferred() const;
+
+        /** The abort that made the transfer fail
+         *
+         * It is only valid if the state is TRANSFER_FAILED
+         */
+        SDOAbort getAbort() const;
+
+    private:
+        enum PHASES
+        {
+            UPLOAD_INITIATE,
+            UPLOAD_SEGMENT,
+            BLOCK_UPLOAD_INITIATE,
+            BLOCK_UPLOAD_DATA,
+            BLOCK_UPLOAD_END,
+            DOWNLOAD_INITIATE,
+            DOWNLOAD_SEGMENT
+        };
+
+        uint8_t mNodeId;
+        TRANSFER_STATES mState = TRANSFER_IDLE;
+        PHASES mPhase = UPLOAD_INITIATE;
+        ObjectID mObject;
+        Sink mSink;
+        Source mSource;
+        uint32_t mSize = 0;
+        uint32_t mTransferred = 0;
+        SDOAbort mAbort;
+        uint8_t mToggle = 0;
+        bool mLastSegment = false;
+
+        uint8_t mBlockSize = 0;
+        uint8_t mExpectedSequence = 0;
+        uint8_t mLastGoodSequence = 0;
+        bool mUseCRC = false;
+        uint16_t mCRC = 0;
+        uint8_t mPending[7];
+        bool mHasPending = false;
+
+        canbus::Message makeRequest(uint8_t command) const;
+        canbus::Message makeInitiateRequest(uint8_t command) const;
+        PROCESS_RESULTS failLocally(uint32_t code, canbus::Message& reply);
+        void deliver(uint8_t const* data, size_t size);
+
+        PROCESS_RESULTS processUploadInitiate(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS processUploadSegment(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS processBlockUploadInitiate(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS processBlockUploadData(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS processBlockUploadEnd(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS processDownloadAck(canbus::Message const& msg, canbus::Message& reply);
+        PROCESS_RESULTS sendDownloadSegment(canbus::Message& reply);
+    };
+}
+
+#endif
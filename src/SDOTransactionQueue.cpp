@@ -0,0 +1,153 @@
+#include <motors_elmo_ds402/SDOTransactionQueue.hpp>
+#include "CANopenProtocol.hpp"
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+SDOTransactionQueue::SDOTransactionQueue(uint8_t nodeId, Policy const& policy)
+    : mNodeId(nodeId)
+    , mPolicy(policy)
+{
+}
+
+void SDOTransactionQueue::push(canbus::Message const& message)
+{
+    mQueue.push_back(message);
+}
+
+void SDOTransactionQueue::push(vector<canbus::Message> const& messages)
+{
+    mQueue.insert(mQueue.end(), messages.begin(), messages.end());
+}
+
+bool SDOTransactionQueue::isSDORequest(canbus::Message const& message) const
+{
+    return message.can_id == SDO_CLIENT_COB_ID + mNodeId && message.size == 8;
+}
+
+bool SDOTransactionQueue::next(base::Time const& now, canbus::Message& message)
+{
+    if (mInFlight)
+    {
+        if (now < mDeadline)
+            return false;
+        else if (mRetries == mPolicy.maxRetries)
+        {
+            fail(TRANSACTION_TIMED_OUT, 0);
+            return next(now, message);
+        }
+
+        ++mRetries;
+        mDeadline = now + mPolicy.timeout;
+        message = mInFlightMessage;
+        return true;
+    }
+
+    if (mQueue.empty())
+        return false;
+
+    message = mQueue.front();
+    mQueue.pop_front();
+    if (isSDORequest(message))
+    {
+        mInFlight = true;
+        mInFlightMessage = message;
+        mInFlightObject = ObjectID {
+            static_cast<uint16_t>(message.data[1] | message.data[2] << 8),
+            message.data[3] };
+        mDeadline = now + mPolicy.timeout;
+        mRetries = 0;
+    }
+    return true;
+}
+
+bool SDOTransactionQueue::process(Update const& update)
+{
+    if (!mInFlight)
+        return false;
+
+    ObjectID const& object = mInFlightObject;
+    if (update.isAcked(object.id, object.subId))
+    {
+        mInFlight = false;
+        return true;
+    }
+
+    for (int i = 0; i < update.getAbortCount(); ++i)
+    {
+        SDOAbort abort = update.getAbort(i);
+        if (abort.object == object)
+        {
+            fail(TRANSACTION_ABORTED, abort.code);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SDOTransactionQueue::fail(TRANSACTION_STATUS status, uint32_t abortCode)
+{
+    mFailures.push_back(Failure { mInFlightMessage, mInFlightObject, status, abortCode });
+    mInFlight = false;
+    if (mPolicy.stopOnFailure)
+        mQueue.clear();
+}
+
+bool SDOTransactionQueue::isInFlight() const
+{
+    return mInFlight;
+}
+
+bool SDOTransactionQueue::isDone() const
+{
+    return !mInFlight && mQueue.empty();
+}
+
+bool SDOTransactionQueue::hasFailed() const
+{
+    return !mFailures.empty();
+}
+
+vector<SDOTransactionQueue::Failure> const& SDOTransactionQueue::getFailures() const
+{
+    return mFailures;
+}
+
+void SDOTransactionQueue::checkFailures() const
+{
+    if (mFailures.empty())
+        return;
+
+    Failure const& failure = mFailures.front();
+    if (failure.status == TRANSACTION_ABORTED)
+        throw SDOAbortError(SDOAbort { failure.object, failure.abortCode });
+    else
+        throw SDOTimeout(failure.object);
+}
+
+string SDOTransactionQueue::describeFailures() const
+{
+    string result;
+    for (auto const& failure : mFailures)
+    {
+        if (!result.empty())
+            result += "\n";
+        if (failure.status == TRANSACTION_ABORTED)
+            result += SDOAbortError(SDOAbort { failure.object, failure.abortCode }).what();
+        else
+            result += SDOTimeout(failure.object).what();
+    }
+    return result;
+}
+
+size_t SDOTransactionQueue::size() const
+{
+    return mQueue.size();
+}
+
+void SDOTransactionQueue::clear()
+{
+    mQueue.clear();
+    mFailures.clear();
+    mInFlight = false;
+}
@@ -0,0 +1,146 @@
+#ifndef MOTORS_ELMO_DS402_SDO_TRANSACTION_QUEUE_HPP
+#define MOTORS_ELMO_DS402_SDO_TRANSACTION_QUEUE_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <canbus/Message.hpp>
+#include <motors_elmo_ds402/Update.hpp>
+
+namespace motors_elmo_ds402
+{
+    /** Timeout and retry policy of SDOTransactionQueue */
+    struct SDOTransactionPolicy
+    {
+        /** How long to wait for the drive's answer */
+        base::Time timeout = base::Time::fromMilliseconds(100);
+        /** How many times a transfer is re-sent after a timeout */
+        int maxRetries = 2;
+        /** Whether the remaining transfers are dropped after one failed
+         *
+         * Set to false if the transfers are independent from each other
+         */
+        bool stopOnFailure = true;
+    };
+
+    /** Sequence of SDO transfers to a single node
+     *
+     * CANopen allows only one SDO transfer in flight per node. This class
+     * holds the transfers that remain to be done, and releases them one at a
+     * time as the previous one completes, handling timeouts, retries and
+     * aborts in the process.
+     *
+     * It does no I/O by itself, and is meant to be driven from a single
+     * event loop: call next() to get the message that should be sent now, if
+     * there is one, and process() with the updates returned by
+     * Controller::process for the node.
+     *
+     * Messages that are not SDO requests (e.g. NMT commands) can be queued
+     * as well. They are released in order, and are considered completed as
+     * soon as they are sent.
+     */
+    class SDOTransactionQueue
+    {
+    public:
+        enum TRANSACTION_STATUS
+        {
+            TRANSACTION_COMPLETED,
+            TRANSACTION_ABORTED,
+            TRANSACTION_TIMED_OUT
+        };
+
+        typedef SDOTransactionPolicy Policy;
+
+        /** A transfer that failed */
+        struct Failure
+        {
+            canbus::Message message;
+            ObjectID object;
+            TRANSACTION_STATUS status;
+            /** The SDO abort code if status is TRANSACTION_ABORTED */
+            uint32_t abortCode;
+        };
+
+        explicit SDOTransactionQueue(uint8_t nodeId, Policy const& policy = Policy());
+
+        /** Queue a message */
+        void push(canbus::Message const& message);
+
+        /** Queue a sequence of messages, as returned by e.g.
+         * Controller::configureJointStateUpdatePDOs
+         */
+        void push(std::vector<canbus::Message> const& messages);
+
+        /** Get the message that should be sent now
+         *
+         * This is either the next queued message if there is no transfer in
+         * flight, or the message of the transfer in flight if it timed out
+         * and should be retried.
+         *
+         * @return true if \c message has been set and must be sent
+         */
+        bool next(base::Time const& now, canbus::Message& message);
+
+        /** Process an update returned by Controller::process
+         *
+         * @return true if it completed or aborted the transfer in flight
+         */
+        bool process(Update const& update);
+
+        /** Whether a transfer is waiting for the drive's answer */
+        bool isInFlight() const;
+
+        /** Whether all queued transfers are finished, successfully or not */
+        bool isDone() const;
+
+        /** Whether at least one transfer failed */
+        bool hasFailed() const;
+
+        /** The transfers that failed so far */
+        std::vector<Failure> const& getFailures() const;
+
+        /** Throws an exception describing the first failed transfer, if
+         * there is one
+         *
+         * @throw SDOAbortError if the drive aborted the transfer
+         * @throw SDOTimeout if the drive did not answer in time
+         */
+        void checkFailures() const;
+
+        /** Describes all the failed transfers, one per line
+         *
+         * Unlike checkFailures(), it does not throw. It returns an empty
+         * string if no transfer failed
+         */
+        std::string describeFailures() const;
+
+        /** Number of queued messages, excluding the one in flight */
+        size_t size() const;
+
+        /** Remove all queued messages and failures, and forget about the
+         * transfer in flight
+         */
+        void clear();
+
+        /** Whether a message is a SDO request to this queue's node, that is
+         * a transfer that waits for the drive's answer
+         */
+        bool isSDORequest(canbus::Message const& message) const;
+
+    private:
+        uint8_t mNodeId;
+        Policy mPolicy;
+        std::deque<canbus::Message> mQueue;
+        std::vector<Failure> mFailures;
+
+        bool mInFlight = false;
+        canbus::Message mInFlightMessage;
+        ObjectID mInFlightObject;
+        base::Time mDeadline;
+        int mRetries = 0;
+
+        void fail(TRANSACTION_STATUS status, uint32_t abortCode);
+    };
+}
+
+#endif
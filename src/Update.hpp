@@ -2,45 +2,161 @@
 #define MOTORS_ELMO_DS402_UPDATE_HPP
 
 #include <cstdint>
+#include <type_traits>
+#include <base/Time.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <motors_elmo_ds402/SDOAbort.hpp>
 
 namespace motors_elmo_ds402
 {
     class Update
     {
-        uint32_t mAckedObjectID;
-        uint32_t mAckedObjectSubID;
+    public:
+        /** Maximum number of acks a single update can hold
+         *
+         * Acks received beyond this are dropped, which can be detected
+         * with hasDroppedAcks()
+         */
+        static const int MAX_ACKS = 16;
+        /** Maximum number of aborts a single update can hold
+         *
+         * Aborts received beyond this are dropped, which can be detected
+         * with hasDroppedAborts()
+         */
+        static const int MAX_ABORTS = 4;
+        /** The objects for which an update holds a receive timestamp
+         *
+         * These are the objects that the Controller decodes directly from
+         * the PDOs. The receive time of the other objects is available
+         * through Controller::timestamp()
+         */
+        enum TIMESTAMPED_OBJECTS
+        {
+            TIMESTAMP_POSITION,
+            TIMESTAMP_VELOCITY,
+            TIMESTAMP_CURRENT,
+            TIMESTAMP_STATUS_WORD,
+            TIMESTAMP_DRIVE_TIMESTAMP,
+            TIMESTAMP_COUNT
+        };
+
+    private:
+        ObjectID mAcks[MAX_ACKS];
+        SDOAbort mAborts[MAX_ABORTS];
+        /** Receive times indexed by TIMESTAMPED_OBJECTS, null if the object
+         * was not received
+         */
+        base::Time mTimestamps[TIMESTAMP_COUNT];
+        uint8_t mAckCount;
+        uint8_t mAbortCount;
+        bool mDroppedAcks;
+        bool mDroppedAborts;
         uint64_t mUpdatedObjects;
+        ObjectSet mUpdatedObjectSet;
+
+        void addAck(ObjectID const& object)
+        {
+            if (mAckCount == MAX_ACKS)
+                mDroppedAcks = true;
+            else
+                mAcks[mAckCount++] = object;
+        }
+
+        void addAbort(SDOAbort const& abort)
+        {
+            if (mAbortCount == MAX_ABORTS)
+                mDroppedAborts = true;
+            else
+                mAborts[mAbortCount++] = abort;
+        }
+
+        static int getTimestampIndex(uint16_t objectId, uint8_t objectSubID)
+        {
+            switch(static_cast<uint32_t>(objectId) << 8 | objectSubID)
+            {
+                case PositionActualInternalValue::OBJECT_ID << 8 |
+                     PositionActualInternalValue::OBJECT_SUB_ID:
+                    return TIMESTAMP_POSITION;
+                case VelocityActualValue::OBJECT_ID << 8 |
+                     VelocityActualValue::OBJECT_SUB_ID:
+                    return TIMESTAMP_VELOCITY;
+                case CurrentActualValue::OBJECT_ID << 8 |
+                     CurrentActualValue::OBJECT_SUB_ID:
+                    return TIMESTAMP_CURRENT;
+                case StatusWordRegister::OBJECT_ID << 8 |
+                     StatusWordRegister::OBJECT_SUB_ID:
+                    return TIMESTAMP_STATUS_WORD;
+                case TimestampUsec::OBJECT_ID << 8 |
+                     TimestampUsec::OBJECT_SUB_ID:
+                    return TIMESTAMP_DRIVE_TIMESTAMP;
+                default:
+                    return -1;
+            }
+        }
+
+        template<typename T>
+        bool isUpdatedDispatch(std::true_type) const
+        {
+            return isUpdated(T::UPDATE_ID);
+        }
+
+        template<typename T>
+        bool isUpdatedDispatch(std::false_type) const
+        {
+            return isObjectUpdated<T>();
+        }
 
     public:
         static Update Ack(int objectId, int objectSubId)
         {
             Update update;
-            update.mAckedObjectID = objectId;
-            update.mAckedObjectSubID = objectSubId;
+            update.addAck(ObjectID {
+                static_cast<uint16_t>(objectId),
+                static_cast<uint8_t>(objectSubId) });
             return update;
         }
 
-        static Update UpdatedObjects(uint64_t updates)
+        static Update Abort(int objectId, int objectSubId, uint32_t code)
+        {
+            Update update;
+            update.addAbort(SDOAbort {
+                ObjectID {
+                    static_cast<uint16_t>(objectId),
+                    static_cast<uint8_t>(objectSubId) },
+                code });
+            return update;
+        }
+
+        static Update UpdatedObjects(uint64_t updates,
+            ObjectSet const& objects = ObjectSet())
         {
             Update update;
             update.mUpdatedObjects = updates;
+            update.mUpdatedObjectSet = objects;
             return update;
 
         }
         Update()
-            : mAckedObjectID(0)
-            , mAckedObjectSubID(0)
+            : mAckCount(0)
+            , mAbortCount(0)
+            , mDroppedAcks(false)
+            , mDroppedAborts(false)
             , mUpdatedObjects(0) {}
 
         bool isAck() const
         {
-            return mAckedObjectID != 0;
+            return mAckCount != 0;
         }
 
         bool isAcked(uint16_t objectId, uint8_t objectSubID) const
         {
-            return (mAckedObjectID == objectId) &&
-                (mAckedObjectSubID == objectSubID);
+            ObjectID object = { objectId, objectSubID };
+            for (int i = 0; i < mAckCount; ++i)
+            {
+                if (mAcks[i] == object)
+                    return true;
+            }
+            return false;
         }
 
         template<typename T>
@@ -49,10 +165,146 @@ namespace motors_elmo_ds402
             return this->isAcked(T::OBJECT_ID, T::OBJECT_SUB_ID);
         }
 
+        /** Number of acks contained in this update */
+        int getAckCount() const
+        {
+            return mAckCount;
+        }
+
+        /** Returns the i-th ack contained in this update */
+        ObjectID getAck(int i) const
+        {
+            return mAcks[i];
+        }
+
+        /** Whether this update contains SDO aborts */
+        bool isAbort() const
+        {
+            return mAbortCount != 0;
+        }
+
+        /** Whether a transfer involving the given object has been aborted */
+        bool isAborted(uint16_t objectId, uint8_t objectSubID) const
+        {
+            ObjectID object = { objectId, objectSubID };
+            for (int i = 0; i < mAbortCount; ++i)
+            {
+                if (mAborts[i].object == object)
+                    return true;
+            }
+            return false;
+        }
+
+        template<typename T>
+        bool isAborted() const
+        {
+            return this->isAborted(T::OBJECT_ID, T::OBJECT_SUB_ID);
+        }
+
+        /** Number of aborts contained in this update */
+        int getAbortCount() const
+        {
+            return mAbortCount;
+        }
+
+        /** Returns the i-th abort contained in this update */
+        SDOAbort getAbort(int i) const
+        {
+            return mAborts[i];
+        }
+
+        /** Whether some acks could not be stored because more than MAX_ACKS
+         * were merged into this update
+         */
+        bool hasDroppedAcks() const
+        {
+            return mDroppedAcks;
+        }
+
+        /** Whether some aborts could not be stored because more than
+         * MAX_ABORTS were merged into this update
+         */
+        bool hasDroppedAborts() const
+        {
+            return mDroppedAborts;
+        }
+
+        /** Record the time at which an object has been received
+         *
+         * If the object already has a timestamp, it is updated. The call is
+         * ignored if the object is not one of TIMESTAMPED_OBJECTS
+         */
+        void setTimestamp(uint16_t objectId, uint8_t objectSubID, base::Time const& time)
+        {
+            int index = getTimestampIndex(objectId, objectSubID);
+            if (index != -1)
+                mTimestamps[index] = time;
+        }
+
+        /** Returns the time at which the given object has been received
+         *
+         * Returns a null time if this update does not contain the object,
+         * or if the object is not one of TIMESTAMPED_OBJECTS
+         */
+        base::Time getTimestamp(uint16_t objectId, uint8_t objectSubID) const
+        {
+            int index = getTimestampIndex(objectId, objectSubID);
+            if (index != -1)
+                return mTimestamps[index];
+            else
+                return base::Time();
+        }
+
+        template<typename T>
+        base::Time getTimestamp() const
+        {
+            return getTimestamp(T::OBJECT_ID, T::OBJECT_SUB_ID);
+        }
+
+        /** Whether the given object got updated
+         *
+         * For objects that have a non-zero UPDATE_ID, this tests the
+         * UPDATE_ID, i.e. it returns true if any object of the same group got
+         * updated. Use isObjectUpdated to test for a specific object.
+         */
         template<typename T>
         bool isUpdated() const
         {
-            return isUpdated(T::UPDATE_ID);
+            return isUpdatedDispatch<T>(
+                std::integral_constant<bool, T::UPDATE_ID != 0>());
+        }
+
+        /** Whether this specific object got updated */
+        template<typename T>
+        bool isObjectUpdated() const
+        {
+            return mUpdatedObjectSet.contains<T>();
+        }
+
+        /** Whether the object at the given index in OBJECT_REGISTRY got
+         * updated
+         */
+        bool isObjectUpdated(int index) const
+        {
+            return mUpdatedObjectSet.test(index);
+        }
+
+        /** Whether all the objects in \c objects got updated */
+        bool isUpdated(ObjectSet const& objects) const
+        {
+            return mUpdatedObjectSet.contains(objects);
+        }
+
+        /** Whether at least one of the objects in \c objects got updated */
+        bool hasOneUpdated(ObjectSet const& objects) const
+        {
+            return mUpdatedObjectSet.intersects(objects);
+        }
+
+        /** The set of objects that got updated */
+        ObjectSet const& getUpdatedObjects() const
+        {
+            return mUpdatedObjectSet;
         }
 
         bool hasOneUpdated(int64_t updateId) const
@@ -65,10 +317,27 @@ namespace motors_elmo_ds402
             return (mUpdatedObjects & updateId) == updateId;
         }
 
-	void merge(Update const& update)
-	{
-	    mUpdatedObjects |= update.mUpdatedObjects;
-	}
+        /** Merge the information of another update into this one
+         *
+         * Updated objects are or-ed, acks and aborts are appended and
+         * the timestamps are updated with the ones from \c update
+         */
+        void merge(Update const& update)
+        {
+            mUpdatedObjects |= update.mUpdatedObjects;
+            mUpdatedObjectSet.merge(update.mUpdatedObjectSet);
+            for (int i = 0; i < update.mAckCount; ++i)
+                addAck(update.mAcks[i]);
+            for (int i = 0; i < update.mAbortCount; ++i)
+                addAbort(update.mAborts[i]);
+            for (int i = 0; i < TIMESTAMP_COUNT; ++i)
+            {
+                if (!update.mTimestamps[i].isNull())
+                    mTimestamps[i] = update.mTimestamps[i];
+            }
+            mDroppedAcks = mDroppedAcks || update.mDroppedAcks;
+            mDroppedAborts = mDroppedAborts || update.mDroppedAborts;
+        }
     };
 }
 
@@ -0,0 +1,266 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/AsyncDrive.hpp>
+#include <deque>
+#include <map>
+
+using namespace motors_elmo_ds402;
+
+namespace {
+    base::Time ms(int value)
+    {
+        return base::Time::fromMilliseconds(value);
+    }
+
+    uint32_t sdoFullId(canbus::Message const& msg)
+    {
+        return static_cast<uint32_t>(msg.data[1] | msg.data[2] << 8) << 8 |
+            msg.data[3];
+    }
+
+    canbus::Message sdoAnswer(int nodeId, uint8_t command,
+        uint16_t objectId, uint8_t subId, uint32_t value)
+    {
+        canbus::Message msg;
+        msg.can_id = 0x580 + nodeId;
+        msg.size = 8;
+        msg.data[0] = command;
+        msg.data[1] = objectId & 0xFF;
+        msg.data[2] = objectId >> 8;
+        msg.data[3] = subId;
+        for (int i = 0; i < 4; ++i)
+            msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+        return msg;
+    }
+
+    /** Fake bus that replays canned answers to the SDO requests
+     *
+     * The answers of a given node and object are replayed in the order in
+     * which they have been added. A request without a canned answer gets no
+     * answer, i.e. it times out.
+     */
+    struct ScriptedBus
+    {
+        typedef std::pair<int, uint32_t> Key;
+        std::map<Key, std::deque<canbus::Message>> answers;
+
+        struct Request
+        {
+            base::Time time;
+            canbus::Message message;
+        };
+        std::vector<Request> requests;
+        base::Time now;
+
+        template<typename T>
+        void uploadAnswer(int nodeId, uint16_t value)
+        {
+            add(nodeId, sdoAnswer(nodeId, 0x4B, T::OBJECT_ID, T::OBJECT_SUB_ID, value));
+        }
+
+        template<typename T>
+        void downloadAck(int nodeId)
+        {
+            add(nodeId, sdoAnswer(nodeId, 0x60, T::OBJECT_ID, T::OBJECT_SUB_ID, 0));
+        }
+
+        template<typename T>
+        void abort(int nodeId, uint32_t code)
+        {
+            add(nodeId, sdoAnswer(nodeId, 0x80, T::OBJECT_ID, T::OBJECT_SUB_ID, code));
+        }
+
+        void add(int nodeId, canbus::Message const& answer)
+        {
+            answers[Key(nodeId, sdoFullId(answer))].push_back(answer);
+        }
+
+        /** Runs the reactor with a 1ms period until all flows are done */
+        void run(AsyncReactor& reactor, base::Time const& maxDuration = ms(5000))
+        {
+            base::Time deadline = now + maxDuration;
+            while (!reactor.isDone())
+            {
+                BOOST_REQUIRE(now < deadline);
+
+                std::vector<canbus::Message> messages;
+                reactor.next(now, messages);
+                for (auto const& msg : messages)
+                {
+                    requests.push_back(Request { now, msg });
+                    auto it = answers.find(Key(msg.can_id & 0x7F, sdoFullId(msg)));
+                    if (it == answers.end() || it->second.empty())
+                        continue;
+
+                    canbus::Message answer = it->second.front();
+                    it->second.pop_front();
+                    answer.time = now;
+                    reactor.process(answer);
+                }
+                now = now + ms(1);
+            }
+        }
+
+        /** The times at which the given object has been requested */
+        template<typename T>
+        std::vector<base::Time> getRequestTimes(int nodeId) const
+        {
+            std::vector<base::Time> result;
+            for (auto const& request : requests)
+            {
+                if ((request.message.can_id & 0x7F) == nodeId &&
+                    sdoFullId(request.message) ==
+                        static_cast<uint32_t>(T::OBJECT_ID << 8 | T::OBJECT_SUB_ID))
+                    result.push_back(request.time);
+            }
+            return result;
+        }
+    };
+
+    Task<void> uploadTemperature(AsyncDrive& drive, uint16_t& result)
+    {
+        result = co_await drive.upload<Temperature>();
+    }
+
+    Task<void> setOperationMode(AsyncDrive& drive, uint32_t& abortCode,
+        bool& timedOut)
+    {
+        try {
+            co_await drive.request(
+                drive.getController().setOperationMode(OPERATION_MODE_CYCLIC_SYNCHRONOUS_TORQUE));
+        }
+        catch(SDOAbortError const& e) {
+            abortCode = e.abort.code;
+        }
+        catch(SDOTimeout const&) {
+            timedOut = true;
+        }
+    }
+
+    Task<void> shutdown(AsyncDrive& drive, base::Time pollPeriod)
+    {
+        co_await drive.transition(ControlWord::SHUTDOWN, false, ms(1000), pollPeriod);
+    }
+
+    struct Fixture
+    {
+        ScriptedBus bus;
+        SDOTransactionQueue::Policy policy;
+
+        Fixture()
+        {
+            bus.now = base::Time::fromSeconds(100);
+            policy.timeout = ms(10);
+            policy.maxRetries = 0;
+        }
+    };
+}
+
+BOOST_FIXTURE_TEST_SUITE(AsyncDriveSuite, Fixture)
+
+BOOST_AUTO_TEST_CASE(it_resumes_an_upload_with_the_uploaded_value)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+    bus.uploadAnswer<Temperature>(1, 42);
+
+    uint16_t temperature = 0;
+    reactor.spawn(uploadTemperature(drive, temperature));
+    bus.run(reactor);
+    reactor.checkErrors();
+    BOOST_REQUIRE_EQUAL(42, temperature);
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_aborts_from_the_co_await_expression)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+    bus.abort<ModesOfOperation>(1, 0x06090030);
+
+    uint32_t abortCode = 0;
+    bool timedOut = false;
+    reactor.spawn(setOperationMode(drive, abortCode, timedOut));
+    bus.run(reactor);
+    BOOST_REQUIRE_EQUAL(0x06090030u, abortCode);
+    BOOST_REQUIRE(!timedOut);
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_timeouts_from_the_co_await_expression)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+
+    uint32_t abortCode = 0;
+    bool timedOut = false;
+    reactor.spawn(setOperationMode(drive, abortCode, timedOut));
+    bus.run(reactor);
+    BOOST_REQUIRE(timedOut);
+}
+
+BOOST_AUTO_TEST_CASE(it_runs_the_flows_of_several_drives_concurrently)
+{
+    AsyncReactor reactor(policy);
+    Controller controller1(1);
+    Controller controller2(2);
+    AsyncDrive& drive1 = reactor.add(controller1);
+    AsyncDrive& drive2 = reactor.add(controller2);
+    bus.uploadAnswer<Temperature>(1, 42);
+    bus.uploadAnswer<Temperature>(2, 43);
+
+    uint16_t temperature1 = 0, temperature2 = 0;
+    reactor.spawn(uploadTemperature(drive1, temperature1));
+    reactor.spawn(uploadTemperature(drive2, temperature2));
+    bus.run(reactor);
+    reactor.checkErrors();
+    BOOST_REQUIRE_EQUAL(42, temperature1);
+    BOOST_REQUIRE_EQUAL(43, temperature2);
+    BOOST_REQUIRE_EQUAL(bus.requests[0].time, bus.requests[1].time);
+}
+
+BOOST_AUTO_TEST_CASE(it_polls_the_status_word_at_most_once_per_poll_period)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+    bus.downloadAck<ControlWordRegister>(1);
+    bus.uploadAnswer<StatusWordRegister>(1, 0x0040);
+    bus.uploadAnswer<StatusWordRegister>(1, 0x0040);
+    bus.uploadAnswer<StatusWordRegister>(1, 0x0021);
+
+    reactor.spawn(shutdown(drive, ms(10)));
+    bus.run(reactor);
+    reactor.checkErrors();
+
+    auto polls = bus.getRequestTimes<StatusWordRegister>(1);
+    BOOST_REQUIRE_EQUAL(3u, polls.size());
+    for (size_t i = 1; i < polls.size(); ++i)
+        BOOST_REQUIRE_GE((polls[i] - polls[i - 1]).toMilliseconds(), 10);
+    BOOST_REQUIRE_EQUAL(StatusWord::READY_TO_SWITCH_ON,
+        controller.tryGetStatusWord().state);
+}
+
+BOOST_AUTO_TEST_CASE(it_fails_the_transition_if_the_drive_goes_in_fault)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+    bus.downloadAck<ControlWordRegister>(1);
+    bus.uploadAnswer<StatusWordRegister>(1, 0x0008);
+
+    reactor.spawn(shutdown(drive, ms(10)));
+    bus.run(reactor);
+    BOOST_REQUIRE_THROW(reactor.checkErrors(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_messages_that_are_not_sdo_requests)
+{
+    AsyncReactor reactor(policy);
+    Controller controller(1);
+    AsyncDrive& drive = reactor.add(controller);
+    BOOST_REQUIRE_THROW(drive.request(controller.querySync()),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
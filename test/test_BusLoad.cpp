@@ -0,0 +1,93 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/BusLoad.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(BusLoadSuite)
+
+static BusFrame syncFrame(int size)
+{
+    BusFrame frame;
+    frame.cobId = 0x181;
+    frame.size = size;
+    return frame;
+}
+
+static BusFrame periodicFrame(int size, base::Time const& period)
+{
+    BusFrame frame;
+    frame.cobId = 0x281;
+    frame.size = size;
+    frame.syncDivisor = 0;
+    frame.period = period;
+    return frame;
+}
+
+BOOST_AUTO_TEST_CASE(it_computes_the_worst_case_frame_length)
+{
+    BOOST_CHECK_EQUAL(55, getWorstCaseFrameBits(0));
+    BOOST_CHECK_EQUAL(135, getWorstCaseFrameBits(8));
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_the_minimum_sync_period_of_synchronous_frames)
+{
+    BusLoad load(1000000, base::Time::fromMilliseconds(1));
+    load.addFrame(syncFrame(8));
+    // 55 bits of SYNC and 135 bits of PDO, at 0.5 bits per microsecond
+    BOOST_CHECK_EQUAL(380, load.getMinimumSyncPeriod(0.5).toMicroseconds());
+}
+
+BOOST_AUTO_TEST_CASE(it_accounts_for_the_frames_that_are_not_triggered_by_the_sync)
+{
+    BusLoad load(1000000, base::Time::fromMilliseconds(1));
+    load.addFrame(syncFrame(8));
+    load.addFrame(periodicFrame(8, base::Time::fromMilliseconds(1)));
+    base::Time period = load.getMinimumSyncPeriod(0.5);
+    BOOST_CHECK_EQUAL(650, period.toMicroseconds());
+
+    load.setSyncPeriod(period);
+    BOOST_CHECK_LE(load.getCycleLoad(), 0.5);
+    load.validate(0.5);
+    load.setSyncPeriod(period - base::Time::fromMicroseconds(1));
+    BOOST_CHECK_GT(load.getCycleLoad(), 0.5);
+    BOOST_CHECK_THROW(load.validate(0.5), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_if_the_asynchronous_frames_exceed_the_budget_on_their_own)
+{
+    BusLoad load(1000000, base::Time::fromMilliseconds(1));
+    load.addFrame(periodicFrame(8, base::Time::fromMicroseconds(200)));
+    BOOST_CHECK_THROW(load.getMinimumSyncPeriod(0.5), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_the_pdo_configuration_of_sdo_downloads)
+{
+    auto download = [](int objectId, int subId, uint32_t value) {
+        canbus::Message msg;
+        msg.can_id = 0x601;
+        msg.size = 8;
+        msg.data[0] = 0x23;
+        msg.data[1] = objectId & 0xFF;
+        msg.data[2] = objectId >> 8;
+        msg.data[3] = subId;
+        for (int i = 0; i < 4; ++i)
+            msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+        return msg;
+    };
+
+    BusLoad load(1000000, base::Time::fromMilliseconds(1));
+    load.addConfiguration(std::vector<canbus::Message> {
+        download(0x1A01, 0, 2),
+        download(0x1A01, 1, 0x60410010),
+        download(0x1A01, 2, 0x60630020),
+        download(0x1801, 2, 1)
+    });
+    auto frames = load.getFrames();
+    BOOST_REQUIRE_EQUAL(2, frames.size());
+    BOOST_CHECK_EQUAL(0x80, frames[0].cobId);
+    BOOST_CHECK_EQUAL(0x281, frames[1].cobId);
+    BOOST_CHECK_EQUAL(6, frames[1].size);
+    BOOST_CHECK_EQUAL(1, frames[1].syncDivisor);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,334 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(ControllerSuite)
+
+static const int NODE_ID = 5;
+
+static canbus::Message sdo(uint32_t cobId, uint8_t command, uint16_t objectId,
+    uint8_t subId, uint32_t value)
+{
+    canbus::Message msg;
+    msg.can_id = cobId + NODE_ID;
+    msg.size = 8;
+    msg.data[0] = command;
+    msg.data[1] = objectId & 0xFF;
+    msg.data[2] = objectId >> 8;
+    msg.data[3] = subId;
+    for (int i = 0; i < 4; ++i)
+        msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+    return msg;
+}
+
+/** Expedited 4-byte download request */
+static canbus::Message download(uint16_t objectId, uint8_t subId, uint32_t value)
+{
+    return sdo(0x600, 0x23, objectId, subId, value);
+}
+
+/** Expedited 4-byte upload response */
+static canbus::Message uploadResponse(uint16_t objectId, uint8_t subId, uint32_t value)
+{
+    return sdo(0x580, 0x43, objectId, subId, value);
+}
+
+static canbus::Message downloadAck(uint16_t objectId, uint8_t subId)
+{
+    return sdo(0x580, 0x60, objectId, subId, 0);
+}
+
+static canbus::Message tpdo(int pdoIndex, std::vector<uint8_t> const& data)
+{
+    canbus::Message msg;
+    msg.can_id = 0x180 + 0x100 * pdoIndex + NODE_ID;
+    msg.size = data.size();
+    std::copy(data.begin(), data.end(), msg.data);
+    msg.time = base::Time::fromSeconds(10);
+    return msg;
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_the_downloads_whose_drive_value_is_unknown)
+{
+    Controller controller(NODE_ID);
+    std::vector<canbus::Message> messages { download(0x6081, 0, 1000) };
+
+    BOOST_REQUIRE_EQUAL(1u, controller.queryDriveValues(messages).size());
+    BOOST_REQUIRE_EQUAL(1u, controller.diffApply(messages).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_removes_the_downloads_that_match_the_uploaded_value)
+{
+    Controller controller(NODE_ID);
+    std::vector<canbus::Message> messages {
+        download(0x6081, 0, 1000), download(0x6083, 0, 500) };
+    controller.process(uploadResponse(0x6081, 0, 1000));
+    controller.process(uploadResponse(0x6083, 0, 400));
+
+    BOOST_REQUIRE_EQUAL(0u, controller.queryDriveValues(messages).size());
+    auto result = controller.diffApply(messages);
+    BOOST_REQUIRE_EQUAL(1u, result.size());
+    BOOST_REQUIRE_EQUAL(0x83, result[0].data[1]);
+}
+
+BOOST_AUTO_TEST_CASE(it_commits_the_written_values_once_acked)
+{
+    Controller controller(NODE_ID);
+    std::vector<canbus::Message> messages {
+        download(0x6081, 0, 1000), download(0x6083, 0, 500) };
+    controller.diffApply(messages);
+    controller.process(downloadAck(0x6081, 0));
+    controller.process(downloadAck(0x6083, 0));
+
+    BOOST_REQUIRE(controller.diffApply(messages).empty());
+}
+
+BOOST_AUTO_TEST_CASE(it_matches_the_acks_with_the_downloads_in_order)
+{
+    Controller controller(NODE_ID);
+    controller.diffApply({ download(0x6081, 0, 1000) });
+    controller.diffApply({ download(0x6081, 0, 2000) });
+    controller.process(downloadAck(0x6081, 0));
+
+    // The first ack is for the first download, not the latest one
+    BOOST_REQUIRE(controller.diffApply({ download(0x6081, 0, 1000) }).empty());
+    BOOST_REQUIRE_EQUAL(1u,
+        controller.diffApply({ download(0x6081, 0, 2000) }).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_forgets_the_value_of_downloads_that_got_no_answer)
+{
+    Controller controller(NODE_ID);
+    controller.process(uploadResponse(0x6081, 0, 1000));
+    controller.diffApply({ download(0x6081, 0, 2000), download(0x6083, 0, 500) });
+    // The first download timed out, the second one got acked
+    controller.process(downloadAck(0x6083, 0));
+
+    std::vector<canbus::Message> messages {
+        download(0x6081, 0, 1000), download(0x6083, 0, 500) };
+    auto queries = controller.queryDriveValues(messages);
+    BOOST_REQUIRE_EQUAL(1u, queries.size());
+    BOOST_REQUIRE_EQUAL(0x81, queries[0].data[1]);
+}
+
+BOOST_AUTO_TEST_CASE(it_forgets_the_value_of_objects_written_outside_of_diffApply)
+{
+    Controller controller(NODE_ID);
+    controller.process(uploadResponse(0x6081, 0, 1000));
+    controller.process(downloadAck(0x6081, 0));
+
+    BOOST_REQUIRE_EQUAL(1u,
+        controller.diffApply({ download(0x6081, 0, 1000) }).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_forgets_the_value_of_aborted_downloads)
+{
+    Controller controller(NODE_ID);
+    controller.process(uploadResponse(0x6081, 0, 1000));
+    controller.diffApply({ download(0x6081, 0, 2000) });
+    controller.process(sdo(0x580, 0x80, 0x6081, 0, 0x06090030));
+
+    BOOST_REQUIRE_EQUAL(1u,
+        controller.diffApply({ download(0x6081, 0, 1000) }).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_packs_the_largest_objects_first_in_the_tpdos)
+{
+    Controller controller(NODE_ID);
+    ObjectSet objects;
+    objects.add<StatusWord>();
+    objects.add<PositionActualInternalValue>();
+    objects.add<VelocityActualValue>();
+    objects.add<CurrentActualValue>();
+    // First-fit in registry order would put the status word, the position
+    // and the current in the first PDO. The decreasing order fills the
+    // first PDO with the two 32-bit objects instead
+    controller.configureTPDOs(1, 2, objects,
+        canopen_master::PDOCommunicationParameters::Sync(1));
+
+    Update update = controller.process(tpdo(1,
+        { 0x78, 0x56, 0x34, 0x12, 0x01, 0x00, 0x00, 0x00 }));
+    BOOST_CHECK(update.isUpdated(UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY));
+    BOOST_CHECK(!update.hasOneUpdated(UPDATE_STATUS_WORD | UPDATE_JOINT_CURRENT));
+    BOOST_CHECK_EQUAL(0x12345678, controller.getRawPosition());
+
+    // Objects of the same size are in registry order
+    update = controller.process(tpdo(2, { 0x37, 0x02, 0x10, 0x00 }));
+    BOOST_CHECK(update.isUpdated(UPDATE_STATUS_WORD | UPDATE_JOINT_CURRENT));
+    BOOST_CHECK(!update.hasOneUpdated(UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY));
+    BOOST_CHECK_EQUAL(0x0237, controller.getStatusWord().raw);
+    BOOST_CHECK_EQUAL(StatusWord::OPERATION_ENABLED, controller.getStatusWord().state);
+}
+
+BOOST_AUTO_TEST_CASE(it_fills_the_gaps_left_by_larger_objects)
+{
+    Controller controller(NODE_ID);
+    ObjectSet objects;
+    objects.add<StatusWord>();
+    objects.add<PositionActualInternalValue>();
+    objects.add<CurrentActualValue>();
+    controller.configureTPDOs(1, 1, objects,
+        canopen_master::PDOCommunicationParameters::Sync(1));
+
+    Update update = controller.process(tpdo(1,
+        { 0x01, 0x00, 0x00, 0x00, 0x37, 0x02, 0x10, 0x00 }));
+    BOOST_CHECK(update.isUpdated(UPDATE_JOINT_POSITION |
+        UPDATE_STATUS_WORD | UPDATE_JOINT_CURRENT));
+    BOOST_CHECK_EQUAL(1, controller.getRawPosition());
+    BOOST_CHECK_EQUAL(0x0237, controller.getStatusWord().raw);
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_if_the_objects_do_not_fit_in_the_tpdos)
+{
+    Controller controller(NODE_ID);
+    ObjectSet objects;
+    objects.add<StatusWord>();
+    objects.add<PositionActualInternalValue>();
+    objects.add<VelocityActualValue>();
+    BOOST_CHECK_THROW(controller.configureTPDOs(1, 1, objects,
+            canopen_master::PDOCommunicationParameters::Sync(1)),
+        std::invalid_argument);
+}
+
+static canbus::Message jointStateTPDO(int32_t position, int32_t velocity)
+{
+    std::vector<uint8_t> data(8);
+    for (int i = 0; i < 4; ++i)
+    {
+        data[i] = (position >> (8 * i)) & 0xFF;
+        data[4 + i] = (velocity >> (8 * i)) & 0xFF;
+    }
+    return tpdo(1, data);
+}
+
+/** Configures TPDO 1 with the position and velocity, and TPDO 2 with the
+ * status word and the current
+ */
+static void configureHotTPDOs(Controller& controller)
+{
+    ObjectSet objects;
+    objects.add<StatusWord>();
+    objects.add<PositionActualInternalValue>();
+    objects.add<VelocityActualValue>();
+    objects.add<CurrentActualValue>();
+    controller.configureTPDOs(1, 2, objects,
+        canopen_master::PDOCommunicationParameters::Sync(1));
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_consider_a_first_sample_to_be_in_the_deadband)
+{
+    Controller controller(NODE_ID);
+    configureHotTPDOs(controller);
+    BOOST_REQUIRE(!controller.isInDeadband(jointStateTPDO(10, 20)));
+    controller.process(jointStateTPDO(10, 20));
+    BOOST_REQUIRE(controller.isInDeadband(jointStateTPDO(10, 20)));
+}
+
+BOOST_AUTO_TEST_CASE(it_uses_a_zero_deadband_by_default)
+{
+    Controller controller(NODE_ID);
+    configureHotTPDOs(controller);
+    controller.process(jointStateTPDO(10, 20));
+    BOOST_REQUIRE(!controller.isInDeadband(jointStateTPDO(11, 20)));
+    BOOST_REQUIRE(!controller.isInDeadband(jointStateTPDO(10, 19)));
+}
+
+BOOST_AUTO_TEST_CASE(it_compares_against_the_last_processed_sample)
+{
+    MotorParameters parameters;
+    parameters.encoderTicks = 4096;
+    parameters.encoderRevolutions = 1;
+    parameters.gearMotorShaftRevolutions = 1;
+    parameters.gearDrivingShaftRevolutions = 1;
+    parameters.feedLength = 1;
+    parameters.feedDrivingShaftRevolutions = 1;
+    parameters.torqueConstant = 0.1;
+
+    Controller controller(NODE_ID);
+    controller.setMotorParameters(parameters);
+    configureHotTPDOs(controller);
+    base::JointState deadband;
+    deadband.position = 0.1;
+    controller.setJointStateDeadband(deadband);
+    int64_t threshold = std::abs(controller.getFactors().rawFromEncoder(0.1));
+    BOOST_REQUIRE_GT(threshold, 0);
+
+    controller.process(jointStateTPDO(1000, 20));
+    BOOST_REQUIRE(controller.isInDeadband(jointStateTPDO(1000 + threshold, 20)));
+    BOOST_REQUIRE(controller.isInDeadband(jointStateTPDO(1000 - threshold, 20)));
+    BOOST_REQUIRE(!controller.isInDeadband(jointStateTPDO(1000 + threshold + 1, 20)));
+    // The velocity has no threshold
+    BOOST_REQUIRE(!controller.isInDeadband(jointStateTPDO(1000, 21)));
+
+    controller.process(jointStateTPDO(1000 + threshold, 20));
+    BOOST_REQUIRE(controller.isInDeadband(jointStateTPDO(1000 + 2 * threshold, 20)));
+}
+
+BOOST_AUTO_TEST_CASE(it_considers_any_status_word_change_significant)
+{
+    Controller controller(NODE_ID);
+    configureHotTPDOs(controller);
+    controller.process(tpdo(2, { 0x37, 0x02, 0x10, 0x00 }));
+    BOOST_REQUIRE(controller.isInDeadband(tpdo(2, { 0x37, 0x02, 0x10, 0x00 })));
+    BOOST_REQUIRE(!controller.isInDeadband(tpdo(2, { 0x33, 0x02, 0x10, 0x00 })));
+}
+
+BOOST_AUTO_TEST_CASE(it_never_considers_other_messages_to_be_in_the_deadband)
+{
+    Controller controller(NODE_ID);
+    configureHotTPDOs(controller);
+    controller.process(jointStateTPDO(10, 20));
+    BOOST_REQUIRE(!controller.isInDeadband(tpdo(3, { 0, 0 })));
+    BOOST_REQUIRE(!controller.isInDeadband(uploadResponse(0x6081, 0, 1000)));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_the_drive_timestamp_on_tpdos_sent_on_change)
+{
+    Controller controller(NODE_ID);
+    ObjectSet objects;
+    objects.add<PositionActualInternalValue>();
+    objects.add<TimestampUsec>();
+    BOOST_REQUIRE_THROW(controller.configureTPDOs(1, 1, objects,
+            canopen_master::PDOCommunicationParameters::Async()),
+        std::invalid_argument);
+    BOOST_REQUIRE_THROW(controller.configureStatusPDO(1,
+            canopen_master::PDOCommunicationParameters::Async(), true),
+        std::invalid_argument);
+    BOOST_REQUIRE_THROW(controller.configureJointStateEventPDOs(1,
+            TPDOEventTiming(), UPDATE_JOINT_POSITION | UPDATE_DRIVE_TIMESTAMP),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_accepts_the_drive_timestamp_on_sync_and_periodic_tpdos)
+{
+    Controller controller(NODE_ID);
+    BOOST_REQUIRE_NO_THROW(controller.configureStatusPDO(1,
+        canopen_master::PDOCommunicationParameters::Sync(1), true));
+    BOOST_REQUIRE_NO_THROW(controller.configureStatusPDO(1,
+        canopen_master::PDOCommunicationParameters::Periodic(
+            base::Time::fromMilliseconds(10)), true));
+    BOOST_REQUIRE_NO_THROW(controller.configureStatusPDO(1,
+        canopen_master::PDOCommunicationParameters::Async(), false));
+}
+
+BOOST_AUTO_TEST_CASE(it_timestamps_the_objects_of_a_tpdo_with_the_sampling_time)
+{
+    Controller controller(NODE_ID);
+    controller.configureStatusPDO(1,
+        canopen_master::PDOCommunicationParameters::Sync(1), true);
+
+    // The timestamp is packed first, as it is the largest object
+    Update update = controller.process(tpdo(1,
+        { 0xE8, 0x03, 0x00, 0x00, 0x37, 0x02 }));
+    BOOST_REQUIRE(update.isUpdated(UPDATE_STATUS_WORD | UPDATE_DRIVE_TIMESTAMP));
+    base::Time sampleTime = controller.getSampleTime();
+    BOOST_REQUIRE(!sampleTime.isNull());
+    BOOST_REQUIRE_EQUAL(sampleTime, update.getTimestamp(
+        TimestampUsec::OBJECT_ID, TimestampUsec::OBJECT_SUB_ID));
+    BOOST_REQUIRE_EQUAL(sampleTime, update.getTimestamp(
+        StatusWordRegister::OBJECT_ID, StatusWordRegister::OBJECT_SUB_ID));
+    BOOST_REQUIRE_EQUAL(0x0237, controller.getStatusWord().raw);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/DriveClock.hpp>
+#include <cmath>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(DriveClockSuite)
+
+static const base::Time HOST_ORIGIN = base::Time::fromSeconds(1000);
+
+static base::Time host(int64_t usec)
+{
+    return HOST_ORIGIN + base::Time::fromMicroseconds(usec);
+}
+
+/** Host time in microseconds relative to HOST_ORIGIN */
+static int64_t relative(base::Time const& time)
+{
+    return (time - HOST_ORIGIN).toMicroseconds();
+}
+
+/** Feed samples at 1kHz with a constant latency of 100us, from a drive
+ * clock that runs faster than the host clock by \c drift ppm
+ */
+static void feed(DriveClock& clock, double drift, base::Time const& duration)
+{
+    for (int64_t t = 0; t < duration.toMicroseconds(); t += 1000)
+    {
+        uint32_t raw = std::llround(t * (1 + drift * 1e-6));
+        clock.update(raw, host(t + 100));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_is_invalid_until_it_received_a_sample)
+{
+    DriveClock clock;
+    BOOST_CHECK(!clock.isValid());
+    BOOST_CHECK(clock.toHostTime(0).isNull());
+    clock.update(0, host(0));
+    BOOST_CHECK(clock.isValid());
+    BOOST_CHECK_EQUAL(0, relative(clock.toHostTime(0)));
+}
+
+BOOST_AUTO_TEST_CASE(it_unwraps_the_32bit_drive_timestamp)
+{
+    DriveClock clock;
+    clock.update(0xFFFFFF00, host(0));
+    BOOST_CHECK_EQUAL(0, clock.unwrap(0xFFFFFF00));
+    BOOST_CHECK_EQUAL(0x200, clock.unwrap(0x100));
+    BOOST_CHECK_EQUAL(-0x100, clock.unwrap(0xFFFFFE00));
+
+    clock.update(0x100, host(0x200));
+    BOOST_CHECK_EQUAL(0x300, clock.unwrap(0x200));
+    BOOST_CHECK_EQUAL(0, clock.unwrap(0xFFFFFF00));
+    BOOST_CHECK_EQUAL(0x200, relative(clock.toHostTime(0x100)));
+}
+
+BOOST_AUTO_TEST_CASE(it_follows_samples_that_arrive_earlier_than_predicted)
+{
+    DriveClock clock;
+    clock.update(0, host(500));
+    clock.update(1000, host(1100));
+    BOOST_CHECK_EQUAL(1100, relative(clock.toHostTime(1000)));
+    BOOST_CHECK_EQUAL(100, relative(clock.toHostTime(0)));
+}
+
+BOOST_AUTO_TEST_CASE(it_follows_samples_that_arrive_later_than_predicted_at_the_offset_gain)
+{
+    DriveClockParameters parameters;
+    parameters.offsetGain = 0.1;
+    DriveClock clock(parameters);
+    clock.update(0, host(0));
+    clock.update(1000, host(2000));
+    BOOST_CHECK_EQUAL(1100, relative(clock.toHostTime(1000)));
+}
+
+BOOST_AUTO_TEST_CASE(it_assumes_no_drift_until_the_minimum_span_is_reached)
+{
+    DriveClock clock;
+    feed(clock, 200, base::Time::fromMilliseconds(500));
+    BOOST_CHECK_EQUAL(0, clock.getDrift());
+}
+
+BOOST_AUTO_TEST_CASE(it_estimates_the_drift)
+{
+    DriveClock clock;
+    feed(clock, 200, base::Time::fromSeconds(3));
+    BOOST_CHECK_CLOSE(200, clock.getDrift(), 1);
+
+    // With a constant latency, the lower envelope is the reception times
+    uint32_t raw = std::llround(2999000 * (1 + 200e-6));
+    BOOST_CHECK_SMALL(relative(clock.toHostTime(raw)) - 2999100, int64_t(2));
+}
+
+BOOST_AUTO_TEST_CASE(it_clamps_the_drift)
+{
+    DriveClock clock;
+    feed(clock, 5000, base::Time::fromSeconds(3));
+    // The clamp applies to the ratio of host time to drive time, so the
+    // drift is not exactly maxDrift
+    BOOST_CHECK_CLOSE(1000, clock.getDrift(), 0.2);
+}
+
+BOOST_AUTO_TEST_CASE(it_forgets_all_samples_on_reset)
+{
+    DriveClock clock;
+    feed(clock, 200, base::Time::fromSeconds(3));
+    clock.reset();
+    BOOST_CHECK(!clock.isValid());
+    BOOST_CHECK_EQUAL(0, clock.getDrift());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
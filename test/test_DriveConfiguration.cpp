@@ -0,0 +1,234 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/DriveConfiguration.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace motors_elmo_ds402;
+
+namespace {
+    DriveConfiguration parse(std::string const& text)
+    {
+        std::istringstream stream(text);
+        return DriveConfiguration::parse(stream, "test.conf");
+    }
+
+    /** Parses \c text and returns the error message */
+    std::string parseError(std::string const& text)
+    {
+        try {
+            parse(text);
+        }
+        catch(ConfigurationError const& e) {
+            return e.what();
+        }
+        BOOST_FAIL("expected a ConfigurationError");
+        return std::string();
+    }
+
+    uint32_t sdoFullId(canbus::Message const& msg)
+    {
+        return static_cast<uint32_t>(msg.data[1] | msg.data[2] << 8) << 8 |
+            msg.data[3];
+    }
+
+    uint32_t sdoValue(canbus::Message const& msg)
+    {
+        return msg.data[4] | msg.data[5] << 8 | msg.data[6] << 16 |
+            static_cast<uint32_t>(msg.data[7]) << 24;
+    }
+
+    /** Removes the frame file on destruction */
+    struct FramesFile
+    {
+        std::string path = "test_DriveConfiguration.frames";
+        ~FramesFile() { std::remove(path.c_str()); }
+
+        void truncate(size_t size)
+        {
+            std::string content;
+            {
+                std::ifstream in(path.c_str(), std::ios::binary);
+                content.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+            }
+            std::ofstream out(path.c_str(), std::ios::binary);
+            out.write(content.data(), std::min(size, content.size()));
+        }
+
+        void write(std::string const& content)
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            out.write(content.data(), content.size());
+        }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(DriveConfigurationSuite)
+
+BOOST_AUTO_TEST_CASE(it_parses_the_motor_parameters)
+{
+    auto config = parse(
+        "# a comment\n"
+        "[motor]\n"
+        "encoder_ticks = 4096\n"
+        "torque_constant = 0.12\n");
+    BOOST_REQUIRE(config.hasMotorParameters());
+    BOOST_REQUIRE_EQUAL(4096, config.getMotorParameters().encoderTicks);
+    BOOST_REQUIRE_CLOSE(0.12, config.getMotorParameters().torqueConstant, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(it_writes_the_objects_sorted_by_id_with_one_write_per_object)
+{
+    auto config = parse(
+        "[objects]\n"
+        "QuickStopOptionCode = 2\n"
+        "MaxCurrent = 5000\n"
+        "QuickStopOptionCode = 0x5\n");
+
+    Controller controller(5);
+    auto messages = config.apply(controller, false);
+    BOOST_REQUIRE_EQUAL(2u, messages.size());
+    BOOST_REQUIRE_EQUAL(0x605A00u, sdoFullId(messages[0]));
+    BOOST_REQUIRE_EQUAL(5u, sdoValue(messages[0]));
+    BOOST_REQUIRE_EQUAL(0x607300u, sdoFullId(messages[1]));
+    BOOST_REQUIRE_EQUAL(5000u, sdoValue(messages[1]));
+    BOOST_REQUIRE_EQUAL(0x605u, messages[0].can_id);
+}
+
+BOOST_AUTO_TEST_CASE(it_skips_the_writes_that_match_the_drive_values)
+{
+    auto config = parse(
+        "[objects]\n"
+        "QuickStopOptionCode = 2\n"
+        "MaxCurrent = 5000\n");
+
+    Controller controller(5);
+    auto messages = config.apply(controller, false);
+    BOOST_REQUIRE_EQUAL(2u, controller.queryDriveValues(messages).size());
+
+    canbus::Message answer = messages[1];
+    answer.can_id = 0x585;
+    answer.data[0] = 0x4B;
+    controller.process(answer);
+
+    auto filtered = config.apply(controller);
+    BOOST_REQUIRE_EQUAL(1u, filtered.size());
+    BOOST_REQUIRE_EQUAL(0x605A00u, sdoFullId(filtered[0]));
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_parse_errors_with_the_line_number)
+{
+    BOOST_REQUIRE_EQUAL("test.conf:2: unknown section 'foo'",
+        parseError("[objects]\n[foo]\n"));
+    BOOST_REQUIRE_EQUAL("test.conf:1: entry outside of a section",
+        parseError("MaxCurrent = 10\n"));
+    BOOST_REQUIRE_EQUAL("test.conf:3: expected 'key = value'",
+        parseError("[objects]\n\nMaxCurrent\n"));
+    BOOST_REQUIRE_EQUAL("test.conf:2: expected an integer, got '10A'",
+        parseError("[objects]\nMaxCurrent = 10A\n"));
+    BOOST_REQUIRE_EQUAL("test.conf:1: invalid section header",
+        parseError("[objects\n"));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_unknown_objects)
+{
+    BOOST_REQUIRE_EQUAL("test.conf:2: unknown object 'DoesNotExist'",
+        parseError("[objects]\nDoesNotExist = 1\n"));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_read_only_objects)
+{
+    BOOST_REQUIRE_EQUAL("test.conf:2: object 'Temperature' is read-only",
+        parseError("[objects]\nTemperature = 1\n"));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_values_out_of_the_object_range)
+{
+    BOOST_REQUIRE_NO_THROW(parse("[objects]\nPolarity = -128\n"));
+    BOOST_REQUIRE_THROW(parse("[objects]\nPolarity = 128\n"), ConfigurationError);
+    BOOST_REQUIRE_NO_THROW(parse("[objects]\nMaxCurrent = 65535\n"));
+    BOOST_REQUIRE_THROW(parse("[objects]\nMaxCurrent = 65536\n"), ConfigurationError);
+    BOOST_REQUIRE_THROW(parse("[objects]\nMaxCurrent = -1\n"), ConfigurationError);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_invalid_pdo_settings)
+{
+    BOOST_REQUIRE_THROW(parse("[status_tpdo]\nindex = 4\n"), ConfigurationError);
+    BOOST_REQUIRE_THROW(parse("[status_tpdo]\ntransmission = sync 0\n"),
+        ConfigurationError);
+    BOOST_REQUIRE_THROW(parse("[status_tpdo]\ntransmission = never\n"),
+        ConfigurationError);
+    BOOST_REQUIRE_THROW(parse("[joint_state_tpdo]\nindex = 3\n"),
+        ConfigurationError);
+    BOOST_REQUIRE_THROW(parse(
+        "[joint_state_tpdo]\nindex = 0\n[status_tpdo]\nindex = 1\n"),
+        ConfigurationError);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_the_drive_timestamp_on_event_driven_tpdos)
+{
+    BOOST_REQUIRE_THROW(parse(
+        "[status_tpdo]\ntransmission = event 1 100\ntimestamp = true\n"),
+        ConfigurationError);
+    BOOST_REQUIRE_THROW(parse(
+        "[joint_state_tpdo]\ntransmission = event 1\nfields = position timestamp\n"),
+        ConfigurationError);
+    BOOST_REQUIRE_NO_THROW(parse(
+        "[status_tpdo]\ntransmission = sync 1\ntimestamp = true\n"));
+}
+
+BOOST_AUTO_TEST_CASE(it_saves_and_loads_frames)
+{
+    auto config = parse("[objects]\nMaxCurrent = 5000\nPolarity = -1\n");
+    Controller controller(5);
+    auto messages = config.apply(controller, false);
+
+    FramesFile file;
+    DriveConfiguration::saveFrames(file.path, messages);
+    auto loaded = DriveConfiguration::loadFrames(file.path);
+    BOOST_REQUIRE_EQUAL(messages.size(), loaded.size());
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(messages[i].can_id, loaded[i].can_id);
+        BOOST_REQUIRE_EQUAL(messages[i].size, loaded[i].size);
+        BOOST_REQUIRE_EQUAL(sdoValue(messages[i]), sdoValue(loaded[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_truncated_frame_files)
+{
+    auto config = parse("[objects]\nMaxCurrent = 5000\nPolarity = -1\n");
+    Controller controller(5);
+    FramesFile file;
+    DriveConfiguration::saveFrames(file.path, config.apply(controller, false));
+
+    // Magic, count and the first frame
+    file.truncate(8 + 13);
+    BOOST_REQUIRE_THROW(DriveConfiguration::loadFrames(file.path),
+        std::runtime_error);
+    file.truncate(6);
+    BOOST_REQUIRE_THROW(DriveConfiguration::loadFrames(file.path),
+        std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_frame_files_with_an_invalid_content)
+{
+    FramesFile file;
+    file.write(std::string("XXXX\0\0\0\0", 8));
+    BOOST_REQUIRE_THROW(DriveConfiguration::loadFrames(file.path),
+        std::runtime_error);
+
+    // One frame with a size of 9
+    std::string frame("EDSF\x01\0\0\0\x05\x06\0\0\x09", 13);
+    file.write(frame + std::string(8, '\0'));
+    BOOST_REQUIRE_THROW(DriveConfiguration::loadFrames(file.path),
+        std::runtime_error);
+
+    BOOST_REQUIRE_THROW(DriveConfiguration::loadFrames("does/not/exist"),
+        std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,50 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <string>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(ObjectRegistrySuite)
+
+BOOST_AUTO_TEST_CASE(it_finds_an_object_by_id)
+{
+    ObjectInfo const* info = findObject(0x6041, 0);
+    BOOST_REQUIRE(info);
+    BOOST_REQUIRE_EQUAL(std::string("StatusWordRegister"), info->name);
+    BOOST_REQUIRE_EQUAL(OBJECT_TYPE_UINT16, info->type);
+    BOOST_REQUIRE_EQUAL(UPDATE_STATUS_WORD, info->updateId);
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_an_object_by_name)
+{
+    ObjectInfo const* info = findObject("SoftwarePositionLimitMax");
+    BOOST_REQUIRE(info);
+    BOOST_REQUIRE_EQUAL(0x607D, info->id);
+    BOOST_REQUIRE_EQUAL(2, info->subId);
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_null_for_unknown_objects)
+{
+    BOOST_REQUIRE(!findObject(0x6041, 1));
+    BOOST_REQUIRE(!findObject("DoesNotExist"));
+    BOOST_REQUIRE_EQUAL(-1, findObjectIndex(0));
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_the_access_rights)
+{
+    BOOST_REQUIRE(!findObject("StatusWordRegister")->isWritable());
+    BOOST_REQUIRE(findObject("TargetPosition")->isWritable());
+    BOOST_REQUIRE(findObject("TargetVelocity")->isWritable());
+    BOOST_REQUIRE(findObject("TargetVelocity")->isReadable());
+}
+
+BOOST_AUTO_TEST_CASE(it_has_one_entry_per_listed_object_in_order)
+{
+    for (size_t i = 0; i < OBJECT_REGISTRY_SIZE; ++i)
+    {
+        uint32_t fullId = OBJECT_REGISTRY[i].fullId();
+        BOOST_CHECK_EQUAL(static_cast<int>(i), findObjectIndex(fullId));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Objects.hpp>
+
+using namespace motors_elmo_ds402;
+
+namespace {
+    template<typename T>
+    uint32_t fullId()
+    {
+        return static_cast<uint32_t>(T::OBJECT_ID) << 8 | T::OBJECT_SUB_ID;
+    }
+
+    /** Reference decoding of the state bits, as specified by DS402 */
+    StatusWord::State referenceState(uint8_t byte)
+    {
+        switch(byte & 0x4F)
+        {
+            case 0x00: return StatusWord::NOT_READY_TO_SWITCH_ON;
+            case 0x40: return StatusWord::SWITCH_ON_DISABLED;
+            case 0x0F: return StatusWord::FAULT_REACTION_ACTIVE;
+            case 0x08: return StatusWord::FAULT;
+        }
+
+        switch(byte & 0x6F)
+        {
+            case 0x21: return StatusWord::READY_TO_SWITCH_ON;
+            case 0x23: return StatusWord::SWITCH_ON;
+            case 0x27: return StatusWord::OPERATION_ENABLED;
+            case 0x07: return StatusWord::QUICK_STOP_ACTIVE;
+        }
+        return StatusWord::INVALID;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ObjectsSuite)
+
+BOOST_AUTO_TEST_CASE(it_returns_the_update_id_of_a_listed_object)
+{
+    BOOST_REQUIRE_EQUAL(UPDATE_STATUS_WORD,
+        getUpdateID(fullId<StatusWordRegister>()));
+    BOOST_REQUIRE_EQUAL(UPDATE_JOINT_POSITION,
+        getUpdateID(fullId<PositionActualInternalValue>()));
+    BOOST_REQUIRE_EQUAL(UPDATE_FACTORS, getUpdateID(fullId<GearRatioNum>()));
+}
+
+BOOST_AUTO_TEST_CASE(it_dispatches_every_listed_object)
+{
+    #define CHECK_UPDATE_ID(object_id, object_sub_id, name, type, update_id) \
+        BOOST_CHECK_EQUAL(uint64_t(name::UPDATE_ID), getUpdateID(fullId<name>()));
+    CANOPEN_OBJECT_LIST(CHECK_UPDATE_ID, CHECK_UPDATE_ID)
+    #undef CHECK_UPDATE_ID
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_zero_for_an_object_that_is_not_listed)
+{
+    BOOST_REQUIRE_EQUAL(0u, getUpdateID(0x1000 << 8));
+    BOOST_REQUIRE_EQUAL(0u, getUpdateID(fullId<StatusWordRegister>() + 1));
+    BOOST_REQUIRE_EQUAL(0u, getUpdateID(0xFFFFFFFF));
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_every_lower_byte_of_the_status_word)
+{
+    for (int byte = 0; byte < 256; ++byte)
+    {
+        BOOST_CHECK_EQUAL(referenceState(byte), StatusWord::parseState(byte));
+        BOOST_CHECK_EQUAL(referenceState(byte),
+            StatusWord::parseState(0xFF00 | byte));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_the_status_word_flags)
+{
+    StatusWord status = StatusWord::tryParse(0x0C37);
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, status.state);
+    BOOST_REQUIRE(status.isValid());
+    BOOST_REQUIRE(status.voltageEnabled);
+    BOOST_REQUIRE(!status.warning);
+    BOOST_REQUIRE(status.targetReached);
+    BOOST_REQUIRE(status.internalLimitActive);
+
+    status = StatusWord::tryParse(0x0088);
+    BOOST_REQUIRE_EQUAL(StatusWord::FAULT, status.state);
+    BOOST_REQUIRE(!status.voltageEnabled);
+    BOOST_REQUIRE(status.warning);
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_an_invalid_status_word_for_unknown_states)
+{
+    StatusWord status = StatusWord::tryParse(0x0001);
+    BOOST_REQUIRE_EQUAL(StatusWord::INVALID, status.state);
+    BOOST_REQUIRE(!status.isValid());
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_from_parse_on_unknown_states)
+{
+    BOOST_REQUIRE_THROW(parse<StatusWord>(uint16_t(0x0001)),
+        StatusWord::UnknownState);
+    BOOST_REQUIRE_EQUAL(StatusWord::SWITCH_ON_DISABLED,
+        parse<StatusWord>(uint16_t(0x0040)).state);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
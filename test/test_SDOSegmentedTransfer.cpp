@@ -0,0 +1,234 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/SDOSegmentedTransfer.hpp>
+#include <cstring>
+#include <string>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(SDOSegmentedTransferSuite)
+
+static const uint8_t NODE_ID = 5;
+
+/** A message from the node's SDO server */
+static canbus::Message server(uint8_t command, std::string const& data = "")
+{
+    canbus::Message msg;
+    msg.can_id = 0x580 + NODE_ID;
+    msg.size = 8;
+    std::memset(msg.data, 0, 8);
+    msg.data[0] = command;
+    std::memcpy(msg.data + 1, data.data(), std::min<size_t>(7, data.size()));
+    return msg;
+}
+
+static canbus::Message serverInitiate(uint8_t command, uint32_t value)
+{
+    canbus::Message msg = server(command);
+    msg.data[1] = 0x00;
+    msg.data[2] = 0x20;
+    msg.data[3] = 0x01;
+    for (int i = 0; i < 4; ++i)
+        msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+    return msg;
+}
+
+struct Fixture
+{
+    SDOSegmentedTransfer transfer;
+    std::string received;
+    canbus::Message reply;
+
+    Fixture()
+        : transfer(NODE_ID) {}
+
+    SDOSegmentedTransfer::Sink sink()
+    {
+        return [this](uint8_t const* data, size_t size) {
+            received.append(reinterpret_cast<char const*>(data), size);
+        };
+    }
+
+    SDOSegmentedTransfer::PROCESS_RESULTS process(canbus::Message const& msg)
+    {
+        std::memset(reply.data, 0, 8);
+        return transfer.process(msg, reply);
+    }
+
+    void checkAbort(uint32_t code)
+    {
+        BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_FAILED, transfer.getState());
+        BOOST_CHECK_EQUAL(0x80, reply.data[0]);
+        BOOST_CHECK_EQUAL(code, transfer.getAbort().code);
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(it_alternates_the_toggle_bit_in_a_segmented_upload, Fixture)
+{
+    canbus::Message request = transfer.upload(0x2001, 1, sink());
+    BOOST_CHECK_EQUAL(0x600 + NODE_ID, request.can_id);
+    BOOST_CHECK_EQUAL(0x40, request.data[0]);
+
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(serverInitiate(0x41, 10)));
+    BOOST_CHECK_EQUAL(10, transfer.getSize());
+    BOOST_CHECK_EQUAL(0x60, reply.data[0]);
+
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x00, "0123456")));
+    BOOST_CHECK_EQUAL(0x70, reply.data[0]);
+
+    // Toggle set, 4 bytes unused, last segment
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_CONSUMED,
+        process(server(0x19, "789")));
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_COMPLETED, transfer.getState());
+    BOOST_CHECK_EQUAL("0123456789", received);
+    BOOST_CHECK_EQUAL(10, transfer.getTransferred());
+}
+
+BOOST_FIXTURE_TEST_CASE(it_aborts_a_segmented_upload_on_a_toggle_bit_error, Fixture)
+{
+    transfer.upload(0x2001, 1, sink());
+    process(serverInitiate(0x41, 10));
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x10, "0123456")));
+    checkAbort(0x05030000);
+    BOOST_CHECK_EQUAL("", received);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_handles_an_expedited_upload_response, Fixture)
+{
+    transfer.upload(0x2001, 1, sink());
+    // Expedited, size indicated, 2 bytes unused
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_CONSUMED,
+        process(serverInitiate(0x4B, 0x4241)));
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_COMPLETED, transfer.getState());
+    BOOST_CHECK_EQUAL("AB", received);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_ignores_messages_from_other_nodes, Fixture)
+{
+    transfer.upload(0x2001, 1, sink());
+    canbus::Message msg = serverInitiate(0x41, 10);
+    msg.can_id = 0x580 + NODE_ID + 1;
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::PROCESS_IGNORED, process(msg));
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_RUNNING, transfer.getState());
+}
+
+BOOST_FIXTURE_TEST_CASE(it_sends_the_segments_of_a_download, Fixture)
+{
+    std::string data = "0123456789";
+    size_t position = 0;
+    auto source = [&](uint8_t* buffer, size_t size) {
+        std::memcpy(buffer, data.data() + position, size);
+        position += size;
+        return size;
+    };
+
+    canbus::Message request = transfer.download(0x2001, 1, data.size(), source);
+    BOOST_CHECK_EQUAL(0x21, request.data[0]);
+    BOOST_CHECK_EQUAL(10, request.data[4]);
+
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(server(0x60)));
+    BOOST_CHECK_EQUAL(0x00, reply.data[0]);
+    BOOST_CHECK_EQUAL("0123456", std::string(reinterpret_cast<char*>(reply.data + 1), 7));
+
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(server(0x20)));
+    // Toggle set, 4 bytes unused, last segment
+    BOOST_CHECK_EQUAL(0x19, reply.data[0]);
+    BOOST_CHECK_EQUAL("789", std::string(reinterpret_cast<char*>(reply.data + 1), 3));
+
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_CONSUMED, process(server(0x30)));
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_COMPLETED, transfer.getState());
+}
+
+BOOST_FIXTURE_TEST_CASE(it_aborts_a_download_on_a_toggle_bit_error, Fixture)
+{
+    auto source = [](uint8_t* buffer, size_t size) {
+        std::memset(buffer, 0, size);
+        return size;
+    };
+    transfer.download(0x2001, 1, 10, source);
+    process(server(0x60));
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(server(0x30)));
+    checkAbort(0x05030000);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_runs_a_block_upload_and_checks_its_crc, Fixture)
+{
+    canbus::Message request = transfer.upload(0x2001, 1, sink(),
+        SDOSegmentedTransfer::TRANSFER_BLOCK, 2);
+    BOOST_CHECK_EQUAL(0xA4, request.data[0]);
+    BOOST_CHECK_EQUAL(2, request.data[4]);
+
+    // CRC supported, size indicated
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(serverInitiate(0xC6, 9)));
+    BOOST_CHECK_EQUAL(0xA3, reply.data[0]);
+
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::PROCESS_CONSUMED,
+        process(server(0x01, "1234567")));
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x82, "89")));
+    BOOST_CHECK_EQUAL(0xA2, reply.data[0]);
+    BOOST_CHECK_EQUAL(2, reply.data[1]);
+    BOOST_CHECK_EQUAL(2, reply.data[2]);
+
+    // 5 bytes unused in the last segment, CRC-16 of "123456789"
+    canbus::Message end = server(0xD5);
+    end.data[1] = 0xC3;
+    end.data[2] = 0x31;
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(end));
+    BOOST_CHECK_EQUAL(0xA1, reply.data[0]);
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_COMPLETED, transfer.getState());
+    BOOST_CHECK_EQUAL("123456789", received);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_aborts_a_block_upload_on_a_crc_error, Fixture)
+{
+    transfer.upload(0x2001, 1, sink(), SDOSegmentedTransfer::TRANSFER_BLOCK, 2);
+    process(serverInitiate(0xC6, 9));
+    process(server(0x01, "1234567"));
+    process(server(0x82, "89"));
+
+    canbus::Message end = server(0xD5);
+    end.data[1] = 0xC4;
+    end.data[2] = 0x31;
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(end));
+    checkAbort(0x05040004);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_acks_the_last_good_sequence_number_of_a_block, Fixture)
+{
+    transfer.upload(0x2001, 1, sink(), SDOSegmentedTransfer::TRANSFER_BLOCK, 3);
+    // No CRC, size not indicated
+    process(serverInitiate(0xC0, 0));
+
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::PROCESS_CONSUMED,
+        process(server(0x01, "abcdefg")));
+    // Segment 2 is lost, segment 3 is out of sequence and ends the block
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x03, "XXXXXXX")));
+    BOOST_CHECK_EQUAL(0xA2, reply.data[0]);
+    BOOST_CHECK_EQUAL(1, reply.data[1]);
+
+    // The server re-sends the data after the last good segment
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x81, "hij")));
+    BOOST_CHECK_EQUAL(1, reply.data[1]);
+
+    // 4 bytes unused in the last segment
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY, process(server(0xD1)));
+    BOOST_CHECK_EQUAL(SDOSegmentedTransfer::TRANSFER_COMPLETED, transfer.getState());
+    BOOST_CHECK_EQUAL("abcdefghij", received);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_rejects_invalid_sequence_numbers, Fixture)
+{
+    transfer.upload(0x2001, 1, sink(), SDOSegmentedTransfer::TRANSFER_BLOCK, 2);
+    process(serverInitiate(0xC0, 0));
+    BOOST_REQUIRE_EQUAL(SDOSegmentedTransfer::PROCESS_REPLY,
+        process(server(0x03, "abcdefg")));
+    checkAbort(0x05040002);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,196 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/SDOTransactionQueue.hpp>
+#include <algorithm>
+
+using namespace motors_elmo_ds402;
+
+namespace {
+    const uint8_t NODE_ID = 5;
+
+    canbus::Message sdoDownload(uint16_t objectId, uint8_t subId)
+    {
+        canbus::Message msg;
+        msg.can_id = 0x600 + NODE_ID;
+        msg.size = 8;
+        uint8_t data[8] = { 0x2B,
+            static_cast<uint8_t>(objectId & 0xFF),
+            static_cast<uint8_t>(objectId >> 8),
+            subId, 0, 0, 0, 0 };
+        std::copy(data, data + 8, msg.data);
+        return msg;
+    }
+
+    canbus::Message nmtStart()
+    {
+        canbus::Message msg;
+        msg.can_id = 0;
+        msg.size = 2;
+        msg.data[0] = 0x01;
+        msg.data[1] = NODE_ID;
+        return msg;
+    }
+
+    base::Time ms(int value)
+    {
+        return base::Time::fromMilliseconds(value);
+    }
+
+    struct Fixture
+    {
+        SDOTransactionPolicy policy;
+        canbus::Message msg;
+
+        Fixture()
+        {
+            policy.timeout = ms(100);
+            policy.maxRetries = 2;
+        }
+    };
+}
+
+BOOST_FIXTURE_TEST_SUITE(SDOTransactionQueueSuite, Fixture)
+
+BOOST_AUTO_TEST_CASE(it_releases_one_transfer_at_a_time)
+{
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(std::vector<canbus::Message> {
+        sdoDownload(0x6060, 0), sdoDownload(0x6040, 0) });
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE_EQUAL(0x60, msg.data[2]);
+    BOOST_REQUIRE_EQUAL(0x60, msg.data[1]);
+    BOOST_REQUIRE(queue.isInFlight());
+    BOOST_REQUIRE(!queue.next(ms(10), msg));
+
+    BOOST_REQUIRE(!queue.process(Update::Ack(0x6040, 0)));
+    BOOST_REQUIRE(queue.process(Update::Ack(0x6060, 0)));
+    BOOST_REQUIRE(queue.next(ms(20), msg));
+    BOOST_REQUIRE_EQUAL(0x40, msg.data[1]);
+    BOOST_REQUIRE(queue.process(Update::Ack(0x6040, 0)));
+    BOOST_REQUIRE(queue.isDone());
+    BOOST_REQUIRE(!queue.hasFailed());
+}
+
+BOOST_AUTO_TEST_CASE(it_releases_non_sdo_messages_without_waiting)
+{
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(nmtStart());
+    queue.push(sdoDownload(0x6060, 0));
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE_EQUAL(0u, msg.can_id);
+    BOOST_REQUIRE(!queue.isInFlight());
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE_EQUAL(0x605u, msg.can_id);
+}
+
+BOOST_AUTO_TEST_CASE(it_resends_the_transfer_in_flight_after_a_timeout)
+{
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE(!queue.next(ms(99), msg));
+    BOOST_REQUIRE(queue.next(ms(100), msg));
+    BOOST_REQUIRE_EQUAL(0x60, msg.data[1]);
+    BOOST_REQUIRE(!queue.next(ms(150), msg));
+    BOOST_REQUIRE(queue.next(ms(200), msg));
+    BOOST_REQUIRE_EQUAL(0x60, msg.data[1]);
+
+    BOOST_REQUIRE(queue.process(Update::Ack(0x6060, 0)));
+    BOOST_REQUIRE(queue.next(ms(210), msg));
+    BOOST_REQUIRE_EQUAL(0x40, msg.data[1]);
+    BOOST_REQUIRE(!queue.hasFailed());
+}
+
+BOOST_AUTO_TEST_CASE(it_fails_the_transfer_once_the_retries_are_exhausted)
+{
+    policy.stopOnFailure = false;
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE(queue.next(ms(100), msg));
+    BOOST_REQUIRE(queue.next(ms(200), msg));
+    // The third timeout fails the transfer and releases the next one
+    BOOST_REQUIRE(queue.next(ms(300), msg));
+    BOOST_REQUIRE_EQUAL(0x40, msg.data[1]);
+
+    BOOST_REQUIRE(queue.hasFailed());
+    auto const& failures = queue.getFailures();
+    BOOST_REQUIRE_EQUAL(1u, failures.size());
+    BOOST_REQUIRE_EQUAL(SDOTransactionQueue::TRANSACTION_TIMED_OUT,
+        failures[0].status);
+    BOOST_REQUIRE_EQUAL(0x6060, failures[0].object.id);
+}
+
+BOOST_AUTO_TEST_CASE(it_records_the_abort_code_of_an_aborted_transfer)
+{
+    policy.stopOnFailure = false;
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE(!queue.process(Update::Abort(0x6040, 0, 0x06090030)));
+    BOOST_REQUIRE(queue.process(Update::Abort(0x6060, 0, 0x06090030)));
+    BOOST_REQUIRE(!queue.isInFlight());
+
+    auto const& failures = queue.getFailures();
+    BOOST_REQUIRE_EQUAL(1u, failures.size());
+    BOOST_REQUIRE_EQUAL(SDOTransactionQueue::TRANSACTION_ABORTED,
+        failures[0].status);
+    BOOST_REQUIRE_EQUAL(0x06090030u, failures[0].abortCode);
+    BOOST_REQUIRE(queue.next(ms(10), msg));
+    BOOST_REQUIRE_EQUAL(0x40, msg.data[1]);
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_the_remaining_transfers_on_failure_if_stopOnFailure_is_set)
+{
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    BOOST_REQUIRE(queue.process(Update::Abort(0x6060, 0, 0x06090030)));
+    BOOST_REQUIRE(queue.isDone());
+    BOOST_REQUIRE_EQUAL(0u, queue.size());
+    BOOST_REQUIRE(!queue.next(ms(10), msg));
+    BOOST_REQUIRE(queue.hasFailed());
+}
+
+BOOST_AUTO_TEST_CASE(it_forgets_everything_on_clear)
+{
+    SDOTransactionQueue queue(NODE_ID, policy);
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    queue.process(Update::Abort(0x6060, 0, 0x06090030));
+
+    queue.clear();
+    BOOST_REQUIRE(queue.isDone());
+    BOOST_REQUIRE(!queue.hasFailed());
+}
+
+BOOST_AUTO_TEST_CASE(it_describes_all_failed_transfers_without_throwing)
+{
+    policy.stopOnFailure = false;
+    policy.maxRetries = 0;
+    SDOTransactionQueue queue(NODE_ID, policy);
+    BOOST_REQUIRE(queue.describeFailures().empty());
+
+    queue.push(sdoDownload(0x6060, 0));
+    queue.push(sdoDownload(0x6040, 0));
+    BOOST_REQUIRE(queue.next(ms(0), msg));
+    queue.process(Update::Abort(0x6060, 0, 0x06090030));
+    BOOST_REQUIRE(queue.next(ms(10), msg));
+    BOOST_REQUIRE(!queue.next(ms(110), msg));
+
+    std::string description = queue.describeFailures();
+    BOOST_REQUIRE_NE(std::string::npos, description.find("\n"));
+    BOOST_REQUIRE_THROW(queue.checkFailures(), SDOAbortError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
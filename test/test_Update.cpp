@@ -0,0 +1,159 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Update.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(UpdateSuite)
+
+BOOST_AUTO_TEST_CASE(it_is_empty_by_default)
+{
+    Update update;
+    BOOST_REQUIRE(!update.isAck());
+    BOOST_REQUIRE_EQUAL(0, update.getAckCount());
+    BOOST_REQUIRE(!update.hasDroppedAcks());
+    BOOST_REQUIRE(!update.hasOneUpdated(~0));
+}
+
+BOOST_AUTO_TEST_CASE(it_appends_the_acks_of_the_merged_update)
+{
+    Update update = Update::Ack(0x6040, 0);
+    update.merge(Update::Ack(0x6060, 0));
+    update.merge(Update::Ack(0x607D, 2));
+
+    BOOST_REQUIRE_EQUAL(3, update.getAckCount());
+    BOOST_REQUIRE_EQUAL(0x6060, update.getAck(1).id);
+    BOOST_REQUIRE(update.isAcked(0x6040, 0));
+    BOOST_REQUIRE(update.isAcked(0x607D, 2));
+    BOOST_REQUIRE(!update.isAcked(0x607D, 1));
+    BOOST_REQUIRE(!update.hasDroppedAcks());
+}
+
+BOOST_AUTO_TEST_CASE(it_ors_the_updated_objects)
+{
+    Update update = Update::UpdatedObjects(0x1);
+    update.merge(Update::UpdatedObjects(0x4));
+    update.merge(Update::Ack(0x6040, 0));
+
+    BOOST_REQUIRE(update.isUpdated(0x5));
+    BOOST_REQUIRE(!update.isUpdated(0x2));
+    BOOST_REQUIRE(update.isAcked(0x6040, 0));
+}
+
+BOOST_AUTO_TEST_CASE(it_flags_acks_that_overflow_the_update)
+{
+    Update update;
+    for (int i = 0; i < Update::MAX_ACKS + 1; ++i)
+        update.merge(Update::Ack(0x2000 + i, 0));
+
+    BOOST_REQUIRE_EQUAL(int(Update::MAX_ACKS), update.getAckCount());
+    BOOST_REQUIRE(update.hasDroppedAcks());
+    BOOST_REQUIRE(update.isAcked(0x2000, 0));
+    BOOST_REQUIRE(!update.isAcked(0x2000 + Update::MAX_ACKS, 0));
+}
+
+BOOST_AUTO_TEST_CASE(it_propagates_the_dropped_acks_flag_through_merges)
+{
+    Update full;
+    for (int i = 0; i < Update::MAX_ACKS + 1; ++i)
+        full.merge(Update::Ack(0x2000 + i, 0));
+
+    Update update;
+    update.merge(full);
+    BOOST_REQUIRE(update.hasDroppedAcks());
+}
+
+BOOST_AUTO_TEST_CASE(it_appends_the_aborts_of_the_merged_update)
+{
+    Update update = Update::Abort(0x6060, 0, 0x06090030);
+    update.merge(Update::Ack(0x6040, 0));
+    update.merge(Update::Abort(0x607D, 2, 0x06010002));
+
+    BOOST_REQUIRE(update.isAbort());
+    BOOST_REQUIRE_EQUAL(2, update.getAbortCount());
+    BOOST_REQUIRE(update.isAborted(0x6060, 0));
+    BOOST_REQUIRE(update.isAborted(0x607D, 2));
+    BOOST_REQUIRE(!update.isAborted(0x6040, 0));
+    BOOST_REQUIRE_EQUAL(0x06010002u, update.getAbort(1).code);
+    BOOST_REQUIRE(update.isAcked(0x6040, 0));
+}
+
+BOOST_AUTO_TEST_CASE(it_flags_aborts_that_overflow_the_update_separately_from_acks)
+{
+    Update update;
+    for (int i = 0; i < Update::MAX_ABORTS + 1; ++i)
+        update.merge(Update::Abort(0x2000 + i, 0, 0x08000000));
+
+    BOOST_REQUIRE_EQUAL(int(Update::MAX_ABORTS), update.getAbortCount());
+    BOOST_REQUIRE(update.hasDroppedAborts());
+    BOOST_REQUIRE(!update.hasDroppedAcks());
+
+    Update merged;
+    merged.merge(update);
+    BOOST_REQUIRE(merged.hasDroppedAborts());
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_flag_aborts_when_acks_overflow)
+{
+    Update update;
+    for (int i = 0; i < Update::MAX_ACKS + 1; ++i)
+        update.merge(Update::Ack(0x2000 + i, 0));
+    BOOST_REQUIRE(!update.hasDroppedAborts());
+}
+
+BOOST_AUTO_TEST_CASE(it_stores_the_timestamp_of_the_pdo_decoded_objects)
+{
+    Update update;
+    update.setTimestamp(0x6063, 0, base::Time::fromMicroseconds(10));
+    update.setTimestamp(0x6041, 0, base::Time::fromMicroseconds(20));
+
+    BOOST_REQUIRE_EQUAL(base::Time::fromMicroseconds(10),
+        update.getTimestamp<PositionActualInternalValue>());
+    BOOST_REQUIRE_EQUAL(base::Time::fromMicroseconds(20),
+        update.getTimestamp<StatusWordRegister>());
+    BOOST_REQUIRE(update.getTimestamp<VelocityActualValue>().isNull());
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_the_timestamp_of_other_objects)
+{
+    Update update;
+    update.setTimestamp(0x6060, 0, base::Time::fromMicroseconds(10));
+    BOOST_REQUIRE(update.getTimestamp(0x6060, 0).isNull());
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_the_timestamps_that_the_merged_update_does_not_have)
+{
+    Update update;
+    update.setTimestamp(0x6063, 0, base::Time::fromMicroseconds(10));
+    update.setTimestamp(0x6078, 0, base::Time::fromMicroseconds(10));
+
+    Update newer;
+    newer.setTimestamp(0x6063, 0, base::Time::fromMicroseconds(30));
+    update.merge(newer);
+
+    BOOST_REQUIRE_EQUAL(base::Time::fromMicroseconds(30),
+        update.getTimestamp<PositionActualInternalValue>());
+    BOOST_REQUIRE_EQUAL(base::Time::fromMicroseconds(10),
+        update.getTimestamp<CurrentActualValue>());
+}
+
+BOOST_AUTO_TEST_CASE(it_tracks_individual_objects_in_the_merged_update)
+{
+    ObjectSet objects;
+    objects.add<ErrorCode>();
+    Update update = Update::UpdatedObjects(0, objects);
+
+    ObjectSet others;
+    others.add<ModesOfOperation>();
+    update.merge(Update::UpdatedObjects(UPDATE_OPERATION_MODE, others));
+
+    BOOST_REQUIRE(update.isObjectUpdated<ErrorCode>());
+    BOOST_REQUIRE(update.isUpdated<ErrorCode>());
+    BOOST_REQUIRE(update.isUpdated<ModesOfOperation>());
+    BOOST_REQUIRE(!update.isObjectUpdated<DeviceType>());
+    BOOST_REQUIRE(!update.isUpdated<DeviceType>());
+
+    objects.add<ModesOfOperation>();
+    BOOST_REQUIRE(update.isUpdated(objects));
+}
+
+BOOST_AUTO_TEST_SUITE_END()